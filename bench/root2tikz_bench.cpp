@@ -0,0 +1,186 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ *
+ * Throughput benchmark of the plot emitters. Each case is repeated until a
+ * minimum time has passed and the rate of output bytes and of processed
+ * coordinates (bins or points) is reported.
+ *
+ * Usage: root2tikz_bench [minimum seconds per case]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <TGraph.h>
+#include <TH1.h>
+#include <TH2.h>
+
+#include "PgfPlotsAxis.hpp"
+#include "PgfPlotsGroupPlot.hpp"
+#include "PgfPlotsPlot.hpp"
+#include "TikzLatex.hpp"
+#include "TikzOptions.hpp"
+
+namespace {
+	/// The minimum time each case is repeated for.
+	double minTime = 0.5;
+
+	/// Random numbers with a fixed seed so that runs are comparable.
+	std::mt19937 generator(12345);
+
+	/** Time a case and print a line of the report.
+	 *
+	 * \param[in] name The name of the case.
+	 * \param[in] size The size of the input, e.g. the number of bins.
+	 * \param[in] coordinates The coordinates processed by a call, zero if not
+	 * 	applicable.
+	 * \param[in] call The benchmarked call returning the number of bytes produced.
+	 */
+	void Run(const std::string &name, const size_t &size,
+	         const size_t &coordinates, const std::function< size_t() > &call)
+	{
+		typedef std::chrono::steady_clock Clock;
+		size_t calls = 0, bytes = 0;
+		double seconds = 0;
+		const Clock::time_point start = Clock::now();
+		do {
+			bytes += call();
+			calls++;
+			seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (seconds < minTime);
+
+		std::printf("%-28s %10zu %10zu %12.3g %12.4g", name.c_str(), size, calls,
+		            seconds / calls, bytes / seconds / 1e6);
+		if (coordinates) std::printf(" %12.4g\n", coordinates * calls / seconds / 1e6);
+		else std::printf(" %12s\n", "-");
+	}
+
+	/// Fill a histogram with a falling spectrum and random fluctuations.
+	void Fill(TH1D &hist) {
+		std::exponential_distribution<double> distribution(5. / hist.GetNbinsX());
+		for (int entry = 0; entry < 4 * hist.GetNbinsX(); entry++) {
+			hist.Fill(hist.GetBinCenter(1) + distribution(generator) * hist.GetBinWidth(1));
+		}
+	}
+
+	void BenchTH1() {
+		for (int nBins : {100, 10000, 1000000}) {
+			TH1D hist("hist", "Energy;E_{#gamma} (keV);Counts", nBins, 0, nBins);
+			Fill(hist);
+			for (std::string style : {"HIST", "E", "E1"}) {
+				Run("PlotTH1 " + style, nBins, nBins, [&]() {
+					return PgfPlotsPlot::PlotTH1(&hist, style).size();
+				});
+			}
+		}
+	}
+
+	void BenchTH2() {
+		for (int nBins : {32, 256, 1024}) {
+			TH2D hist("hist", "", nBins, 0, 1, nBins, 0, 1);
+			std::uniform_real_distribution<double> distribution(1, 100);
+			for (int ybin = 1; ybin <= nBins; ybin++) {
+				for (int xbin = 1; xbin <= nBins; xbin++) {
+					hist.SetBinContent(xbin, ybin, distribution(generator));
+				}
+			}
+			const size_t nCells = nBins * nBins;
+			Run("PlotTH2 matrix", nCells, nCells, [&]() {
+				return PgfPlotsPlot::PlotTH2(&hist).size();
+			});
+			Run("PlotTH2 SURF", nCells, nCells, [&]() {
+				return PgfPlotsPlot::PlotTH2(&hist, "SURF").size();
+			});
+		}
+	}
+
+	void BenchTGraph() {
+		for (int nPoints : {100, 10000, 1000000}) {
+			TGraph graph(nPoints);
+			std::normal_distribution<double> distribution(0, 1);
+			for (int point = 0; point < nPoints; point++) {
+				graph.SetPoint(point, point * 0.01, distribution(generator));
+			}
+			Run("PlotTGraph", nPoints, nPoints, [&]() {
+				return PgfPlotsPlot::PlotTGraph(&graph).size();
+			});
+		}
+	}
+
+	void BenchOptions() {
+		for (int nOptions : {4, 64, 1024}) {
+			std::string options;
+			for (int option = 0; option < nOptions; option++) {
+				if (option) options += ", ";
+				options += "option" + std::to_string(option) + "={a=" + std::to_string(option)
+					+ ", b={1,2}}, flag" + std::to_string(option);
+			}
+			Run("TikzOptions::Add", 2 * nOptions, 0, [&]() {
+				TikzOptions tikzOptions;
+				tikzOptions.Add(options);
+				return options.size();
+			});
+		}
+	}
+
+	void BenchLatex() {
+		const std::string title = "E_{#gamma} (keV) vs #theta_{lab} for #alpha + ^{12}C";
+		for (int repeat : {1, 16, 256}) {
+			std::string str;
+			for (int copy = 0; copy < repeat; copy++) str += title + " ";
+			Run("GetLatexString", str.size(), 0, [&]() {
+				return PgfPlotsAxis::GetLatexString(str).size();
+			});
+			Run("TikzLatex::Translate", str.size(), 0, [&]() {
+				return TikzLatex::Translate(str).size();
+			});
+		}
+	}
+
+	void BenchGroupPlot() {
+		const int nBins = 1000;
+		for (int nRows : {2, 4, 8}) {
+			std::vector< TH1D* > hists;
+			std::vector< PgfPlotsPlot* > plots;
+			PgfPlotsGroupPlot groupPlot(nRows, nRows);
+			for (int plotId = 0; plotId < nRows * nRows; plotId++) {
+				hists.push_back(new TH1D(("hist" + std::to_string(plotId)).c_str(),
+				                         ";x;y", nBins, 0, 1));
+				Fill(*hists.back());
+				plots.push_back(new PgfPlotsPlot(hists.back()));
+				groupPlot.AddPlot(plots.back(), plotId);
+			}
+			Run("GroupPlot::Write", nRows * nRows, nRows * nRows * nBins, [&]() {
+				std::stringbuf buf;
+				groupPlot.Write(&buf);
+				return buf.str().size();
+			});
+			for (size_t plotId = 0; plotId < plots.size(); plotId++) {
+				delete plots[plotId];
+				delete hists[plotId];
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) minTime = std::atof(argv[1]);
+	TH1::AddDirectory(false);
+
+	std::printf("%-28s %10s %10s %12s %12s %12s\n", "case", "size", "calls",
+	            "s/call", "MB/s", "Mcoords/s");
+	BenchTH1();
+	BenchTH2();
+	BenchTGraph();
+	BenchOptions();
+	BenchLatex();
+	BenchGroupPlot();
+	return 0;
+}
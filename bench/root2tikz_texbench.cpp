@@ -0,0 +1,324 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ *
+ * End-to-end benchmark of the generated output. A standard corpus of figures
+ * is written with each emission mode and compiled with a TeX engine. The
+ * compile time, TeX memory used and size of the output are reported and
+ * written to texbench.csv in the output directory.
+ *
+ * Usage: root2tikz_texbench <TeX engine> <output directory>
+ *
+ * Returns 77, which the test treats as skipped, if the engine is unavailable,
+ * and 1 if a figure fails to compile for a reason other than TeX memory or
+ * the pages of the paginated group plot are written with different options.
+ */
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <TGraph.h>
+#include <TH1.h>
+#include <TH2.h>
+
+#include "PgfPlotsAxis.hpp"
+#include "PgfPlotsGroupPlot.hpp"
+#include "PgfPlotsPlot.hpp"
+#include "TikzPicture.hpp"
+
+namespace {
+	/// The return code marking the test as skipped.
+	const int kSkipped = 77;
+
+	/// The objects plotted in the figures.
+	struct Corpus {
+		std::unique_ptr< TH1D > spectrum, counts;
+		std::unique_ptr< TH2D > matrix;
+		std::unique_ptr< TGraph > trace;
+	};
+
+	/// An emission mode, applied to every plot and picture.
+	struct Mode {
+		std::string name;
+		std::function< void(PgfPlotsPlot&, const std::string &stem) > plot;
+		std::function< void(TikzPicture&) > picture;
+	};
+
+	/// The compile result of a figure.
+	struct Result {
+		double seconds;
+		long memory;
+		long texSize, pdfSize;
+		bool success;
+		/// Flag indicating the compilation ran out of TeX memory.
+		bool capacityExceeded;
+	};
+
+	Corpus CreateCorpus() {
+		std::mt19937 generator(12345);
+		Corpus corpus;
+		corpus.spectrum.reset(new TH1D("spectrum", ";E_{#gamma} (keV);Counts", 10000, 0, 10000));
+		std::exponential_distribution<double> energy(1e-3);
+		for (int entry = 0; entry < 100000; entry++) corpus.spectrum->Fill(energy(generator));
+
+		corpus.counts.reset(new TH1D("counts", ";Channel;Counts", 500, 0, 500));
+		std::normal_distribution<double> channel(250, 50);
+		for (int entry = 0; entry < 10000; entry++) corpus.counts->Fill(channel(generator));
+
+		corpus.matrix.reset(new TH2D("matrix", ";x;y;z", 200, 0, 1, 200, 0, 1));
+		for (int xbin = 1; xbin <= 200; xbin++) {
+			for (int ybin = 1; ybin <= 200; ybin++) {
+				const double x = corpus.matrix->GetXaxis()->GetBinCenter(xbin) - 0.5;
+				const double y = corpus.matrix->GetYaxis()->GetBinCenter(ybin) - 0.5;
+				corpus.matrix->SetBinContent(xbin, ybin, 100 * std::exp(-(x * x + y * y) / 0.05));
+			}
+		}
+
+		corpus.trace.reset(new TGraph(50000));
+		std::normal_distribution<double> noise(0, 0.1);
+		for (int point = 0; point < 50000; point++) {
+			corpus.trace->SetPoint(point, point * 1e-3, std::sin(point * 1e-3) + noise(generator));
+		}
+		return corpus;
+	}
+
+	/** Write a figure of the corpus with the given mode.
+	 *
+	 * \param[in] corpus The plotted objects.
+	 * \param[in] mode The emission mode.
+	 * \param[in] figure The name of the figure.
+	 * \param[in] stem The file name without extension.
+	 */
+	void WriteFigure(const Corpus &corpus, const Mode &mode,
+	                 const std::string &figure, const std::string &stem)
+	{
+		TikzPicture picture;
+		mode.picture(picture);
+		std::vector< std::unique_ptr< PgfPlotsPlot > > plots;
+		std::unique_ptr< PgfPlotsAxis > axis;
+		std::unique_ptr< PgfPlotsGroupPlot > groupPlot;
+
+		auto AddPlot = [&](PgfPlotsPlot *plot) {
+			plots.emplace_back(plot);
+			mode.plot(*plot, stem + "-" + std::to_string(plots.size()));
+			return plot;
+		};
+
+		if (figure == "group") {
+			groupPlot.reset(new PgfPlotsGroupPlot(2, 2));
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.spectrum.get())), 0);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.counts.get(), "E1")), 1);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.trace.get(), "L")), 2);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.counts.get())), 3);
+		}
+		else if (figure == "pages") {
+			//Two pages of two rows, each page should be written alike.
+			groupPlot.reset(new PgfPlotsGroupPlot(4, 1));
+			groupPlot->SetPageRows(2);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.spectrum.get())), 0);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.counts.get())), 1);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.spectrum.get())), 2);
+			groupPlot->AddPlot(AddPlot(new PgfPlotsPlot(corpus.counts.get())), 3);
+			picture.SetPageBreak("");
+		}
+		else {
+			axis.reset(new PgfPlotsAxis());
+			if (figure == "spectrum") axis->AddPlot(AddPlot(new PgfPlotsPlot(corpus.spectrum.get())));
+			if (figure == "errors") axis->AddPlot(AddPlot(new PgfPlotsPlot(corpus.counts.get(), "E1")));
+			if (figure == "matrix") axis->AddPlot(AddPlot(new PgfPlotsPlot(corpus.matrix.get())));
+			if (figure == "graph") axis->AddPlot(AddPlot(new PgfPlotsPlot(corpus.trace.get(), "L")));
+		}
+		picture.Add(groupPlot ? groupPlot.get() : axis.get());
+		picture.Write(stem + ".tex");
+
+		//Wrap the figure in a document with memory statistics in the log.
+		std::ofstream document(stem + "-doc.tex");
+		document << "\\documentclass{standalone}\n"
+			"\\usepackage{pgfplots}\n"
+			"\\pgfplotsset{compat=1.12}\n"
+			"\\usepgfplotslibrary{groupplots}\n"
+			"\\tracingstats=1\n"
+			"\\begin{document}\n"
+			"\\input{" << stem << ".tex}\n"
+			"\\end{document}\n";
+	}
+
+	/** Compare the group plot options written on each page of a figure.
+	 *
+	 * \param[in] filename The figure file.
+	 * \return True if there is more than one page and all have the same options.
+	 */
+	bool IdenticalPages(const std::string &filename) {
+		std::ifstream file(filename);
+		const std::string content((std::istreambuf_iterator< char >(file)),
+		                          std::istreambuf_iterator< char >());
+
+		static const std::string begin = "\\begin{groupplot}[";
+		static const std::string end = "\t\t]\n";
+		std::vector< std::string > pages;
+		size_t position = content.find(begin);
+		while (position != std::string::npos) {
+			const size_t last = content.find(end, position);
+			if (last == std::string::npos) return false;
+			pages.push_back(content.substr(position, last - position));
+			position = content.find(begin, last);
+		}
+
+		if (pages.size() < 2) return false;
+		for (auto &page : pages) {
+			if (page != pages.front()) return false;
+		}
+		return true;
+	}
+
+	long FileSize(const std::string &filename) {
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file) return 0;
+		return file.tellg();
+	}
+
+	/** Find the memory used in a log file. TeX reports e.g. "12345 words of
+	 * memory out of 5000000", LuaTeX reports the node memory instead.
+	 */
+	long MemoryUsed(const std::string &filename) {
+		std::ifstream log(filename);
+		std::string line;
+		while (std::getline(log, line)) {
+			if (line.find("words of memory") == std::string::npos
+				&& line.find("words of node memory") == std::string::npos) continue;
+			return std::atol(line.c_str());
+		}
+		return 0;
+	}
+
+	/// Check if a log file reports that TeX ran out of memory.
+	bool CapacityExceeded(const std::string &filename) {
+		std::ifstream log(filename);
+		std::string line;
+		while (std::getline(log, line)) {
+			if (line.find("TeX capacity exceeded") != std::string::npos) return true;
+		}
+		return false;
+	}
+
+	/** Compile a figure and collect the results.
+	 *
+	 * \param[in] engine The TeX engine.
+	 * \param[in] directory The output directory.
+	 * \param[in] stem The figure file name without extension and directory.
+	 */
+	Result Compile(const std::string &engine, const std::string &directory,
+	               const std::string &stem)
+	{
+		typedef std::chrono::steady_clock Clock;
+		const std::string command = "cd '" + directory + "' && '" + engine
+			+ "' -interaction=batchmode -halt-on-error '" + stem + "-doc.tex' > /dev/null 2>&1";
+
+		const Clock::time_point start = Clock::now();
+		const int status = std::system(command.c_str());
+		Result result;
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		result.success = status == 0;
+		result.memory = MemoryUsed(directory + "/" + stem + "-doc.log");
+		result.capacityExceeded = !result.success
+			&& CapacityExceeded(directory + "/" + stem + "-doc.log");
+		result.texSize = FileSize(directory + "/" + stem + ".tex");
+		result.pdfSize = FileSize(directory + "/" + stem + "-doc.pdf");
+		return result;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " <TeX engine> <output directory>\n";
+		return 1;
+	}
+	const std::string engine = argv[1];
+
+	const std::string check = "'" + engine + "' --version > /dev/null 2>&1";
+	if (engine == "" || std::system(check.c_str()) != 0) {
+		std::cout << "No TeX engine found ('" << engine << "'), skipping.\n";
+		return kSkipped;
+	}
+	//The figures reference their tables by the full path.
+	char path[PATH_MAX];
+	if (std::system(("mkdir -p '" + std::string(argv[2]) + "'").c_str()) != 0
+		|| !realpath(argv[2], path))
+	{
+		std::cerr << "ERROR: Unable to create directory '" << argv[2] << "'!\n";
+		return 1;
+	}
+	const std::string directory = path;
+
+	TH1::AddDirectory(false);
+	const Corpus corpus = CreateCorpus();
+
+	const std::vector< Mode > modes = {
+		{"inline",
+			[](PgfPlotsPlot&, const std::string&) {},
+			[](TikzPicture&) {}},
+		{"precision3",
+			[](PgfPlotsPlot &plot, const std::string&) {plot.SetPrecision(3);},
+			[](TikzPicture&) {}},
+		{"tables",
+			[](PgfPlotsPlot&, const std::string&) {},
+			[](TikzPicture &picture) {picture.SetExternalData();}},
+		{"reduced",
+			[](PgfPlotsPlot &plot, const std::string&) {plot.SetResolution(8);},
+			[](TikzPicture&) {}},
+		{"image",
+			[](PgfPlotsPlot &plot, const std::string &stem) {
+				if (plot.GetHist2d()) plot.SetRenderImage(stem + ".png");
+			},
+			[](TikzPicture&) {}},
+	};
+	const std::vector< std::string > figures = {"spectrum", "errors", "matrix", "graph", "group",
+		"pages"};
+
+	std::ofstream csv(directory + "/texbench.csv");
+	csv << "mode,figure,seconds,memory,tex bytes,pdf bytes,success,capacity exceeded\n";
+	std::printf("%-12s %-10s %10s %12s %12s %12s\n", "mode", "figure", "seconds",
+	            "memory", "tex bytes", "pdf bytes");
+
+	int failures = 0;
+	for (auto &mode : modes) {
+		for (auto &figure : figures) {
+			const std::string stem = mode.name + "-" + figure;
+			WriteFigure(corpus, mode, figure, directory + "/" + stem);
+			const Result result = Compile(engine, directory, stem);
+
+			std::printf("%-12s %-10s %10.3f %12ld %12ld %12ld%s\n", mode.name.c_str(),
+			            figure.c_str(), result.seconds, result.memory, result.texSize,
+			            result.pdfSize, result.success ? "" :
+			            result.capacityExceeded ? " CAPACITY EXCEEDED" : " FAILED");
+			csv << mode.name << ',' << figure << ',' << result.seconds << ','
+				<< result.memory << ',' << result.texSize << ',' << result.pdfSize << ','
+				<< result.success << ',' << result.capacityExceeded << '\n';
+			if (!result.success && !result.capacityExceeded) failures++;
+
+			if (figure == "pages" && !IdenticalPages(directory + "/" + stem + ".tex")) {
+				std::cout << "The pages of " << stem << " are written with different options.\n";
+				failures++;
+			}
+		}
+	}
+
+	//Figures exceeding the TeX memory are a result, any other compile error
+	//or differing pages is a defect of the generated output and fails the test.
+	if (failures) {
+		std::cout << failures << " figures failed.\n";
+		return 1;
+	}
+	return 0;
+}
@@ -13,35 +13,98 @@
 #include <utility>
 
 #include "TikzOptions.hpp"
+#include "TikzReport.hpp"
 #include "PgfPlotsLegend.hpp"
 #include "PgfPlotsPlot.hpp"
 
 class PgfPlotsAxis {
 	public:
+		/// A numeric range of axis values, unset until a value is included.
+		struct Range {
+			Range();
+
+			/// Return true if a value has been included.
+			bool IsSet() const {return min <= max;}
+
+			/// Extend the range to include the interval [low, high].
+			void Include(const double &low, const double &high);
+
+			bool operator==(const Range &other) const {
+				return min == other.min && max == other.max;
+			}
+			bool operator!=(const Range &other) const {return !(*this == other);}
+
+			double min;
+			double max;
+		};
+
 		PgfPlotsAxis(const std::string &options="");
+		virtual ~PgfPlotsAxis() {}
 
 		/// Add a plot item to the axis.
 		void AddPlot(PgfPlotsPlot *plot);
 
 		/// Converts a ROOT TLatex string to a valid LaTeX string.
-		static std::string GetLatexString(std::string str);
+		static std::string GetLatexString(const std::string &str);
 
 		/// Return a pointer to the TikzOptions object.
 		TikzOptions* GetOptions() {return &options_;}
 
+		/// Return all plots drawn by this axis.
+		virtual std::vector< PgfPlotsPlot* > GetPlots() {return plots_;}
+
+		/// Return the limits of an axis, x=0, y=1, point meta=2, set by the options or the plots.
+		Range GetLimits(const short &axis);
+
+		/// Select if the limits of an axis are written, cleared if shared by a group plot.
+		void SetWriteLimits(const short &axis, const bool &writeLimits = true);
+
+		/// Set the point meta range shared with other axes, unset to use the own limits.
+		void SetSharedMetaRange(const Range &range) {sharedMetaRange_ = range;}
+
 		/// Set the legend for the axis.
 		void SetLegend(PgfPlotsLegend *legend);
 
+		/// Add the options, legend and plots determining the output to a hash.
+		virtual void Hash(TikzHash &hash);
+
 		/// Specify the log mode for a given axis.
 		void SetLog(const short &axis, const bool &logMode = true);
 
 		/// Write out the axis and registered plots.
 		void Write(std::streambuf *buf = std::cout.rdbuf());
 
+		/// Return the cost of the last write of the axis and its plots.
+		const TikzReport::Axis &GetReport() {return report_;}
+
 	protected:
 		/// Options for the axis command.
 		TikzOptions options_;
 
+		/// The cost of the last write.
+		TikzReport::Axis report_;
+
+		/// The ranges of the x, y and point meta values of the plots.
+		std::array< Range, 3 > ranges_;
+
+		/// Flags indicating the ranges are written as axis limits.
+		std::array< bool, 3 > writeLimits_;
+
+		/// The point meta range shared with other axes, e.g. of a group plot.
+		Range sharedMetaRange_;
+
+		/// The option names of the lower and upper limit of each axis.
+		static const std::array< std::array< const char*, 2 >, 3 > kLimitOptions;
+
+		/// Return the line starting the environment including the options.
+		std::string GetHeader();
+
+		/// Append the options and limits to the environment header.
+		virtual void AppendOptions(std::string &header);
+
+		/// Return the plots written by Write.
+		virtual std::vector< PgfPlotsPlot* > GetWrittenPlots() {return GetPlots();}
+
 	private:
 		/// Vector of registered plots.
 		std::vector< PgfPlotsPlot* > plots_;
@@ -57,6 +120,12 @@ class PgfPlotsAxis {
 
 		virtual void PreprocessOptions() {};
 
+		/// Append the limits not set by the options to the environment header.
+		void AppendLimits(std::string &header);
+
+		/// Estimate the TeX main memory needed for the written plots.
+		virtual size_t EstimateTexMemory();
+
 		/// Write out all registered items.
 		virtual void WriteRegisteredItems(std::streambuf *buf);
 };
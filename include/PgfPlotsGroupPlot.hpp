@@ -6,9 +6,13 @@
 #ifndef PGFPLOTSGROUPPLOT_HPP
 #define PGFPLOTSGROUPPLOT_HPP
 
+#include <memory>
+
 #include "PgfPlotsAxis.hpp"
 #include "PgfPlotsGroupSubPlot.hpp"
 
+class TikzDocument;
+
 class PgfPlotsGroupPlot : public PgfPlotsAxis {
 	public:
 		PgfPlotsGroupPlot(unsigned int rows, unsigned int columns, std::string options="");
@@ -18,20 +22,70 @@ class PgfPlotsGroupPlot : public PgfPlotsAxis {
 
 		void SetGlobalAxisLimits(short axis = -1, bool limitGlobally = true);
 
+		/// Add the group plot and its sub plots to a hash.
+		void Hash(TikzHash &hash);
+
+		/// Return the plots of all sub plots.
+		std::vector< PgfPlotsPlot* > GetPlots();
+
 		/// Get the sub plot object for a given id.
 		PgfPlotsGroupSubPlot* GetSubPlot(unsigned int plotId);
 
+		/// Return the number of rows and columns.
 		const std::pair<unsigned short, unsigned short> GetPlotDims();
 
 		/// Set the sub plot object for a given id.
 		void SetSubPlot(unsigned int plotId, PgfPlotsGroupSubPlot* subPlot);
 
+		/// Set the number of threads writing sub plots, zero uses all hardware threads.
+		void SetThreads(const unsigned int &nThreads) {nThreads_ = nThreads;}
+
+		/// Create the sub plots in a document instead of owning them.
+		void SetDocument(TikzDocument *document) {document_ = document;}
+
+		/// Add group style options, e.g. the separation of the sub plots.
+		void SetGroupStyle(const std::string &groupStyle);
+
+		/// Split the grid into pages of the given number of rows, zero writes a single page.
+		void SetPageRows(const unsigned int &pageRows) {pageRows_ = pageRows;}
+
+		/// Return the number of pages the grid is written on.
+		unsigned int GetPages();
+
+		/// Select the page written by the next Write, see TikzPicture.
+		void SetPage(const unsigned int &page);
+
 	private:
+		/// The dimensions of the grid.
+		unsigned int rows_;
+		unsigned int columns_;
+
+		/// Group style options other than the dimensions.
+		TikzOptions groupStyle_;
+
+		/// The rows per page, zero if the grid is not split.
+		unsigned int pageRows_;
+
+		/// The page being written.
+		unsigned int page_;
+
+		/// The names of the options added by the preprocessing.
+		std::vector< std::string > preprocessedOptions_;
+
 		/// The registered sub plots.
 		std::vector< PgfPlotsGroupSubPlot* > subPlots_;
 
+		/// The sub plots created by the group plot if there is no document.
+		std::vector< std::unique_ptr< PgfPlotsGroupSubPlot > > ownedSubPlots_;
+
+		/// The document creating the sub plots, null if they are owned.
+		TikzDocument *document_;
+
 		std::array<bool, 3> globalAxisLimits_;
 
+		/// The number of threads used to write the sub plots.
+		unsigned int nThreads_;
+
 		/// The LaTeX command starting the environment.
 		std::string EnvHeader() {return "\\begin{groupplot}";};
 
@@ -41,6 +95,18 @@ class PgfPlotsGroupPlot : public PgfPlotsAxis {
 		/// Perform some preprocessing prior to output.
 		virtual void PreprocessOptions();
 
+		/// Add an option unless defined, removed again before the next preprocessing.
+		void AddPreprocessedOption(const std::string &name, const std::string &value);
+
+		/// Add group style options, other than the dimensions, to the group style.
+		void MergeGroupStyle(const std::string &groupStyle);
+
+		/// Return the range [first, last) of the sub plots on the current page.
+		std::pair< size_t, size_t > GetPageSubPlots();
+
+		/// Return the plots of the sub plots on the current page.
+		std::vector< PgfPlotsPlot* > GetWrittenPlots();
+
 		/// Determine axis label placement.
 		void ProcessAxisLabels();
 
@@ -50,9 +116,19 @@ class PgfPlotsGroupPlot : public PgfPlotsAxis {
 		/// Process the axis limits.
 		void ProcessGlobalLimits();
 
+		/// Estimate the TeX main memory of the largest sub plot on the page.
+		size_t EstimateTexMemory();
+
+		/// Append the group style of the current page and the options.
+		void AppendOptions(std::string &header);
+
 		/// Write out the group plot and registered sub plots.
 		void WriteRegisteredItems(std::streambuf *buf);
 
+		/// Write the sub plots in the range [first, last).
+		void WriteSubPlots(std::streambuf *buf, const size_t &first,
+		                   const size_t &last);
+
 		void WriteSubPlotPlaceHolder(std::streambuf *buf);
 };
 
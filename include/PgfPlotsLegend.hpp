@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "TikzHash.hpp"
 #include "TikzOptions.hpp"
 
 class PgfPlotsLegend {
@@ -17,6 +18,9 @@ class PgfPlotsLegend {
 		/// Return a pointer to the legend style TikzOptions object.
 		TikzOptions* GetStyle() {return &style_;}
 
+		/// Add the entries and style to a hash.
+		void Hash(TikzHash &hash);
+
 		/// Write out the axis and registered plots.
 		void Write(std::streambuf *buf = std::cout.rdbuf());
 
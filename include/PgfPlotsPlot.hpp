@@ -5,7 +5,10 @@
 #ifndef PGFPLOTSPLOT_HPP
 #define PGFPLOTSPLOT_HPP
 
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
@@ -15,10 +18,20 @@
 #include <TH1.h>
 #include <TH2.h>
 
+#include "TikzHash.hpp"
 #include "TikzOptions.hpp"
+#include "TikzReport.hpp"
+#include "TikzWriter.hpp"
 
 class PgfPlotsPlot {
 	public:
+		/// Reduction applied to histograms with bins finer than the resolution.
+		enum RebinMode {kEnvelope, kMergeBins};
+
+		/// The representation used to write the data.
+		enum Strategy {kFull, kRunMerged, kRebinned, kDecimated, kSparse, kImage,
+		               kCompact};
+
 		PgfPlotsPlot(const TH1* hist, const std::string &rootStyle="",
 		             const std::string &options="");
 		PgfPlotsPlot(const TGraph* graph, const std::string &rootStyle="",
@@ -35,18 +48,88 @@ class PgfPlotsPlot {
 		/// Return a pointer to the TikzOptions object.
 		TikzOptions* GetOptions() {return &options_;}
 
+		/// Set the number of significant digits used for coordinates.
+		void SetPrecision(const int &precision) {precision_ = precision;}
+
+		/// Write the coordinates to an external table file.
+		void SetTableFile(const std::string &filename) {tableFile_ = filename;}
+
+		/// Return the external table file, empty if the data is inline.
+		const std::string &GetTableFile() {return tableFile_;}
+
+		/// Reduce the written points to the resolution of the figure.
+		void SetResolution(const double &width, const double &dpi = 300);
+
+		/// Select how histograms are reduced to the resolution.
+		void SetRebinMode(const RebinMode &rebinMode);
+
+		/// Set the occupancy below which a TH2 only writes its filled bins.
+		void SetSparseThreshold(const double &occupancy) {
+			sparseThreshold_ = occupancy;
+			sparseThresholdSet_ = true;
+		}
+
+		/// Render a TH2 to an image embedded in the axis, set before adding to an axis.
+		void SetRenderImage(const std::string &imageName) {imageName_ = imageName;}
+
+		/// Write only the contents of uniformly binned histograms, the default.
+		void SetCompact(const bool &compact = true) {compact_ = compact;}
+
+		/// Set the point meta range the rendered image colors are mapped to.
+		void SetMetaRange(const double &min, const double &max) {
+			metaMin_ = min;
+			metaMax_ = max;
+		}
+
+		/// Return the rendered image name, empty if the data is drawn by TikZ.
+		const std::string &GetRenderImage() {return imageName_;}
+
+		/// Set the number of threads formatting coordinates, zero uses all hardware threads.
+		void SetThreads(const unsigned int &nThreads) {nThreads_ = nThreads;}
+
+		/// Limit the coordinates written by selecting the representation, zero disables.
+		void SetBudget(const size_t &coordinates) {budget_ = coordinates;}
+
+		/// Return the coordinate budget, zero if disabled.
+		const size_t &GetBudget() {return budget_;}
+
+		/// Return the coordinates of the cheapest lossless representation.
+		size_t GetLosslessCoordinates();
+
+		/// Estimate the number of bytes written to the picture.
+		size_t EstimateBytes();
+
+		/// Return the name of a representation.
+		static std::string GetStrategyName(const Strategy &strategy);
+
+		/// The number of coordinates formatted by a thread at a time.
+		static const size_t kChunkCoordinates = 1 << 15;
+
+		/// The typical bytes of a coordinate and of the plot command itself.
+		static const size_t kBytesPerCoordinate = 32;
+		static const size_t kBytesPerPlot = 512;
+
 		/// Generate the string to create a node for a plot.
 		static std::string NodeString(std::string nodeLabel,
 		                              std::string nodeOptions="");
 
 		/// Write out the TikZ addplot command for the given arguments.
 		static std::string PlotTH1(const TH1 *hist, const std::string &rootStyle="",
-		                           const std::string &options="");
+		                           const std::string &options="",
+		                           const int &precision=0);
 		static std::string PlotTGraph(const TGraph *graph,
 		                              const std::string &rootStyle="",
-		                              const std::string &options="");
+		                              const std::string &options="",
+		                              const int &precision=0);
 		static std::string PlotTH2(const TH2 *hist, const std::string &rootStyle="",
-		                           const std::string &options="");
+		                           const std::string &options="",
+		                           const int &precision=0);
+
+		/// Add the data and settings determining the output to a hash.
+		void Hash(TikzHash &hash);
+
+		/// Return the cost of the last write of the plot.
+		const TikzReport::Plot &GetReport() {return report_;}
 
 		/// Write out the plot.
 		void Write(std::streambuf *buf = std::cout.rdbuf());
@@ -63,5 +146,95 @@ class PgfPlotsPlot {
 
 		/// Node label and options.
 		std::vector< std::pair< std::string, std::string > > nodes_;
+
+		/// Significant digits for coordinates, zero for shortest round trip.
+		int precision_;
+
+		/// The external table file, empty for inline coordinates.
+		std::string tableFile_;
+
+		/// The pre-rendered image file, empty if TikZ draws the data.
+		std::string imageName_;
+
+		/// The point meta range of the axis, NaN to use the range of the data.
+		double metaMin_;
+		double metaMax_;
+
+		/// Pixel columns of the figure used to reduce points, zero disables.
+		unsigned int resolution_;
+
+		/// The reduction applied to fine binned histograms.
+		RebinMode rebinMode_;
+
+		/// The TH2 occupancy below which the sparse output is used.
+		double sparseThreshold_;
+
+		/// Flag indicating the sparse threshold was set by the user.
+		bool sparseThresholdSet_;
+
+		/// The TH2 bins merged along x and y to fit the budget.
+		int budgetMergeX_;
+		int budgetMergeY_;
+
+		/// Flag indicating uniform bins are written without their x and y values.
+		bool compact_;
+
+		/// The number of threads used to format the coordinates.
+		unsigned int nThreads_;
+
+		/// The maximum number of coordinates, zero if unlimited.
+		size_t budget_;
+
+		/// The cost of the last write.
+		TikzReport::Plot report_;
+
+		/// Writes the items in the range [first, last) to a writer.
+		typedef std::function< void(TikzWriter&, const size_t&, const size_t&) > ItemWriter;
+
+		/// Write items in chunks which are formatted concurrently.
+		void WriteChunked(TikzWriter &data, const size_t &nItems,
+		                  const size_t &itemCoordinates, const ItemWriter &writeItems);
+
+		/// Open the table file and reference it in the plot command.
+		std::unique_ptr< TikzWriter > BeginTable(TikzWriter &output,
+			std::filebuf &tableBuf, const std::string &tableOptions = "");
+
+		/// Select the reduction settings fitting the data into the budget.
+		void ApplyBudget();
+
+		/// Record the coordinates of the written data in the report.
+		void ReportData(const TikzWriter &data, const bool &table,
+		                const size_t &items, const size_t &suppressed,
+		                const Strategy &strategy);
+
+		/// Write a coordinate inline or as a table row.
+		void WriteCoordinate(TikzWriter &data, const double &x, const double &y);
+		void WriteCoordinate(TikzWriter &data, const double &x, const double &y,
+		                     const double &z);
+		/// Write a row of a table whose coordinates follow from the row index.
+		void WriteRow(TikzWriter &data, const double &value);
+		void WriteRow(TikzWriter &data, const double &value, const double &error);
+		void WriteErrorCoordinate(TikzWriter &data, const double &x,
+		                          const double &y, const double &xError,
+		                          const double &yError);
+
+		/// Stream the addplot command for the given object.
+		void WriteTH1(TikzWriter &output, const TH1 *hist,
+		              const std::string &options);
+		void WriteTGraph(TikzWriter &output, const TGraph *graph,
+		                 const std::string &options);
+		void WriteTH2(TikzWriter &output, const TH2 *hist,
+		              const std::string &options);
+
+		/// Stream the filled bins of a histogram as rectangular patches.
+		void WriteSparse(TikzWriter &output, const TH2 *hist,
+		                 const std::string &options);
+
+		/// Render the histogram and stream the addplot graphics command.
+		void WriteImage(TikzWriter &output, const TH2 *hist,
+		                const std::string &options);
+
+		/// Stream the registered nodes.
+		void WriteNodes(TikzWriter &output);
 };
 #endif //PGFPLOTSPLOT_HPP
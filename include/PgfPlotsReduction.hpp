@@ -0,0 +1,44 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef PGFPLOTSREDUCTION_HPP
+#define PGFPLOTSREDUCTION_HPP
+
+#include <vector>
+
+#include <TH1.h>
+#include <TH2.h>
+
+/**Methods reducing the number of coordinates written for a plot while
+ * keeping the rendered figure visually identical at a given resolution.
+ */
+class PgfPlotsReduction {
+	public:
+		/// Return the number of pixel columns for a figure width in cm.
+		static unsigned int PixelColumns(const double &width, const double &dpi);
+
+		/// Select the first, last, minimum and maximum point of each bucket.
+		static std::vector< int > MinMaxDecimate(const int &nPoints,
+			const double *x, const double *y, const unsigned int &buckets);
+
+		/// Select the minimum and maximum bin of each group of bins.
+		static std::vector< int > EnvelopeBins(const TH1 *hist,
+		                                       const unsigned int &columns);
+
+		/// Return an integer number of bins to be merged, zero if none fits.
+		static int MergeFactor(const int &nBins, const unsigned int &columns);
+
+		/// Return the fraction of bins with non zero content.
+		static double Occupancy(const TH2 *hist);
+
+	private:
+		/// Select the extreme bins from the content array.
+		template < typename Content >
+		static std::vector< int > EnvelopeBins(const Content &content,
+		                                       const int &nBins,
+		                                       const int &groupSize);
+};
+
+#endif // PGFPLOTSREDUCTION_HPP
@@ -0,0 +1,69 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZBATCH_HPP
+#define TIKZBATCH_HPP
+
+#include <string>
+#include <vector>
+
+#include "TikzPicture.hpp"
+
+/**Writes many pictures concurrently. Each job writes one picture to one
+ * file. Pictures only read their histograms and graphs while being written,
+ * so the source objects may be shared between jobs, but a picture, axis or
+ * plot object may only belong to a single job.
+ */
+class TikzBatch {
+	public:
+		/// The outcome of a single job.
+		struct Job {
+			TikzPicture *picture;
+			std::string filename;
+			/// Time spent writing the picture in seconds.
+			double seconds;
+			/// The error message, empty if the picture was written.
+			std::string error;
+		};
+
+		/// Aggregate timing of a batch.
+		struct Statistics {
+			size_t jobs;
+			size_t failed;
+			unsigned int threads;
+			/// Elapsed time of the whole batch in seconds.
+			double wallTime;
+			/// Sum of the time spent in the individual jobs in seconds.
+			double jobTime;
+			/// The longest single job in seconds.
+			double maxJobTime;
+		};
+
+		TikzBatch(const unsigned int &nThreads = 0);
+
+		/// Add a picture to be written to the given file.
+		void Add(TikzPicture *picture, const std::string &filename);
+
+		/// Return the jobs and their outcome.
+		const std::vector< Job > &GetJobs() {return jobs_;}
+
+		/// Set the number of threads, zero uses all hardware threads.
+		void SetThreads(const unsigned int &nThreads) {nThreads_ = nThreads;}
+
+		/// Write all pictures.
+		Statistics Write();
+
+	private:
+		/// The registered jobs.
+		std::vector< Job > jobs_;
+
+		/// The number of threads.
+		unsigned int nThreads_;
+
+		/// Check that no object is written by more than one job.
+		void CheckJobs();
+};
+
+#endif // TIKZBATCH_HPP
@@ -0,0 +1,124 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZDOCUMENT_HPP
+#define TIKZDOCUMENT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TGraph.h>
+#include <TH1.h>
+
+class TikzPicture;
+class PgfPlotsAxis;
+class PgfPlotsGroupPlot;
+class PgfPlotsLegend;
+class PgfPlotsPlot;
+
+/**Owns the pictures, axes, group plots, legends and plots of a figure set.
+ * The objects are placed in large blocks of memory taken from a monotonic
+ * pool, which avoids an allocation per object. All objects are destroyed
+ * together when the document is released or destroyed, so a figure set is
+ * torn down in one step and objects created by the library, such as the
+ * sub plots of a group plot, are not leaked. The objects may not be deleted
+ * individually. The histograms and graphs are not owned by the document.
+ */
+class TikzDocument {
+	public:
+		TikzDocument(const size_t &blockSize = kBlockSize);
+		~TikzDocument();
+
+		TikzDocument(const TikzDocument&) = delete;
+		TikzDocument& operator=(const TikzDocument&) = delete;
+
+		/// Create a picture owned by the document.
+		TikzPicture* NewPicture(const std::string &options="",
+		                        const std::string &preamble="");
+
+		/// Create an axis owned by the document.
+		PgfPlotsAxis* NewAxis(const std::string &options="");
+
+		/// Create a group plot owned by the document, including its sub plots.
+		PgfPlotsGroupPlot* NewGroupPlot(unsigned int rows, unsigned int columns,
+		                                const std::string &options="");
+
+		/// Create a legend owned by the document.
+		PgfPlotsLegend* NewLegend();
+
+		/// Create a plot owned by the document.
+		PgfPlotsPlot* NewPlot(const TH1* hist, const std::string &rootStyle="",
+		                      const std::string &options="");
+		PgfPlotsPlot* NewPlot(const TGraph* graph, const std::string &rootStyle="",
+		                      const std::string &options="");
+
+		/// Construct an object of any type in the document.
+		template < typename T, typename... Args >
+		T* New(Args&&... args);
+
+		/// Destroy all objects, keeping the first block for reuse.
+		void Release();
+
+		/// Return the number of objects owned by the document.
+		size_t GetObjects() const {return objects_.size();}
+
+		/// Return the number of bytes reserved in blocks.
+		size_t GetBytes() const;
+
+		/// The default size of the memory blocks.
+		static const size_t kBlockSize = 1 << 16;
+
+	private:
+		/// An owned object and the function destroying it.
+		struct Object {
+			void *object;
+			void (*destroy)(void*);
+		};
+
+		/// The size of newly reserved blocks.
+		size_t blockSize_;
+
+		/// The memory blocks and their sizes, the last one is being filled.
+		std::vector< std::pair< std::unique_ptr< char[] >, size_t > > blocks_;
+
+		/// The number of bytes used in the last block.
+		size_t used_;
+
+		/// The owned objects in the order they were created.
+		std::vector< Object > objects_;
+
+		/// Return aligned memory from the current block or a new one.
+		void* Allocate(const size_t &size, const size_t &alignment);
+
+		/// Call the destructor of an object of the given type.
+		template < typename T >
+		static void Destroy(void *object) {static_cast<T*>(object)->~T();}
+};
+
+/** The object is constructed in place with the given arguments and
+ * destroyed when the document is released. The slot recording the object
+ * is reserved first, so that no constructed object is left unrecorded if
+ * memory runs out.
+ *
+ * \param[in] args The arguments of the constructor.
+ * \return A pointer to the new object.
+ */
+template < typename T, typename... Args >
+T* TikzDocument::New(Args&&... args) {
+	if (objects_.size() == objects_.capacity()) {
+		objects_.reserve(std::max< size_t >(2 * objects_.size(), 16));
+	}
+	void *memory = Allocate(sizeof(T), alignof(T));
+	T *object = new (memory) T(std::forward< Args >(args)...);
+	objects_.push_back(Object{object, &Destroy< T >});
+	return object;
+}
+
+#endif // TIKZDOCUMENT_HPP
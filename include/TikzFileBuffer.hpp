@@ -0,0 +1,47 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZFILEBUFFER_HPP
+#define TIKZFILEBUFFER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**A streambuf collecting the content of a file in one contiguous block of
+ * memory. The content is committed with a single write to a uniquely named
+ * temporary file which is then renamed over the destination. On network
+ * file systems this avoids the many small writes of a file stream, and
+ * readers such as latexmk never see a partially written file.
+ */
+class TikzFileBuffer : public std::streambuf {
+	public:
+		TikzFileBuffer(const size_t &size = 0);
+
+		/// Reserve memory for the expected size of the content.
+		void Reserve(const size_t &size);
+
+		/// Return the number of characters collected.
+		size_t GetSize() const {return pptr() - pbase();}
+
+		/// Write the content to the file, replacing it atomically.
+		void Commit(const std::string &filename);
+
+	protected:
+		int overflow(int c);
+		std::streamsize xsputn(const char *data, std::streamsize length);
+
+	private:
+		/// The storage of the content.
+		std::vector< char > data_;
+
+		/// Grow the storage to hold at least the given size.
+		void Grow(const size_t &size);
+
+		/// Advance the put pointer by a number of characters.
+		void Advance(size_t length);
+};
+
+#endif // TIKZFILEBUFFER_HPP
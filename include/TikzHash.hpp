@@ -0,0 +1,49 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZHASH_HPP
+#define TIKZHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**A fast 64 bit hash used to detect changes of the content of a picture. The
+ * data is consumed in eight byte words, so hashing the raw bin arrays of a
+ * histogram is much cheaper than formatting them. The hash is not suited
+ * for cryptographic purposes.
+ */
+class TikzHash {
+	public:
+		TikzHash();
+
+		/// Add a block of bytes.
+		void Add(const void *data, const size_t &length);
+
+		/// Add a string including its length.
+		void Add(const std::string &str);
+
+		/// Add the bytes of a plain value.
+		template < typename T >
+		void AddValue(const T &value) {Add(&value, sizeof(T));}
+
+		/// Return the hash of the data added so far.
+		uint64_t GetValue() const;
+
+		/// Return the hash as a string of sixteen hexadecimal digits.
+		std::string GetString() const;
+
+	private:
+		/// Mix a word into the state.
+		void Mix(const uint64_t &word);
+
+		/// The current state.
+		uint64_t state_;
+
+		/// The number of bytes added.
+		uint64_t length_;
+};
+
+#endif // TIKZHASH_HPP
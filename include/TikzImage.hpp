@@ -0,0 +1,55 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZIMAGE_HPP
+#define TIKZIMAGE_HPP
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TH2.h>
+
+/**An indexed color image used to pre-render histogram contents. The image is
+ * placed in a TikZ rendered axis with `\addplot graphics`, while the axis and
+ * color bar are still drawn by pgfplots. Index zero is transparent, matching
+ * the transparent empty bins of the matrix plots.
+ */
+class TikzImage {
+	public:
+		TikzImage(const unsigned int &width, const unsigned int &height);
+
+		/// Create an image with one pixel per bin of a two-dimensional histogram.
+		static TikzImage FromTH2(const TH2 *hist, const double &zMin,
+		                         const double &zMax);
+
+		/// Set the palette index of a pixel, the origin is the top left corner.
+		void SetPixel(const unsigned int &x, const unsigned int &y,
+		              const unsigned char &index);
+
+		/// Write the image as an indexed color PNG file.
+		void WritePng(const std::string &filename) const;
+
+		/// The number of colors in the palette including the transparent color.
+		static const unsigned int kPaletteSize = 256;
+
+	private:
+		/// The dimensions of the image.
+		unsigned int width_;
+		unsigned int height_;
+
+		/// The palette index of each pixel stored row by row.
+		std::vector< unsigned char > pixels_;
+
+		/// The RGB palette.
+		std::vector< std::array< unsigned char, 3 > > palette_;
+
+		/// Write a single PNG chunk.
+		static void WriteChunk(std::ostream &file, const char *type,
+		                       const std::vector< unsigned char > &data);
+};
+
+#endif // TIKZIMAGE_HPP
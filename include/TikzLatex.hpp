@@ -0,0 +1,30 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZLATEX_HPP
+#define TIKZLATEX_HPP
+
+#include <string>
+
+/**Converts ROOT TLatex strings, e.g. axis titles, into LaTeX. A report
+ * typically has many plots sharing a few distinct titles, so the converted
+ * strings are kept in a cache shared by all threads.
+ */
+class TikzLatex {
+	public:
+		/// Convert a TLatex string to LaTeX, using the cache.
+		static std::string Get(const std::string &str);
+
+		/// Convert a TLatex string to LaTeX without the cache.
+		static std::string Translate(const std::string &str);
+
+		/// Remove all cached strings.
+		static void ClearCache();
+
+		/// The number of cached strings above which the cache is cleared.
+		static const size_t kMaxCacheSize = 4096;
+};
+
+#endif // TIKZLATEX_HPP
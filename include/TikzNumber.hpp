@@ -0,0 +1,44 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZNUMBER_HPP
+#define TIKZNUMBER_HPP
+
+#include <cstddef>
+#include <iostream>
+
+/**Formats floating point values for coordinate output without going through
+ * the locale aware iostream machinery. Values are written either with the
+ * shortest representation that parses back to the identical double, or with
+ * a fixed number of significant digits.
+ */
+class TikzNumber {
+	public:
+		TikzNumber(const double &value, const int &precision = 0);
+
+		/// The formatted value, null terminated.
+		const char* c_str() const {return buffer_;}
+
+		/// The number of characters in the formatted value.
+		size_t size() const {return length_;}
+
+		/// Write a value into a buffer of at least kMaxLength characters.
+		static size_t Format(const double &value, char *buffer,
+		                     const int &precision = 0);
+
+		/// The maximum number of characters written by Format.
+		static const size_t kMaxLength = 32;
+
+	private:
+		/// The formatted value.
+		char buffer_[kMaxLength];
+
+		/// The number of characters in the buffer.
+		size_t length_;
+};
+
+std::ostream& operator<<(std::ostream &output, const TikzNumber &number);
+
+#endif // TIKZNUMBER_HPP
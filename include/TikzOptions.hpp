@@ -6,18 +6,52 @@
 #ifndef TIKZOPTIONS_HPP
 #define TIKZOPTIONS_HPP
 
-#include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
-class TikzOptions : public std::map< std::string, std::string > {
+/**A list of TikZ options kept in the order they were added. The options are
+ * stored in a flat vector, which for the typical handful of options is
+ * faster to search than a tree and avoids a heap node per option. An option
+ * added a second time keeps its first argument. Whether an option was given
+ * with an equal sign is kept, as "title=" and "title" differ in pgfplots.
+ */
+class TikzOptions {
 	public:
-		TikzOptions(std::string options="");
+		typedef std::pair< std::string, std::string > Option;
+		typedef std::vector< Option >::iterator iterator;
+		typedef std::vector< Option >::const_iterator const_iterator;
+
+		TikzOptions(const std::string &options="");
 
 		/// Add options.
 		void Add(const std::string &options);
 
-		bool IsDefined(const std::string &optionName);
+		bool IsDefined(const std::string &optionName) const;
+
+		/// Check if an option was given with an argument, even an empty one.
+		bool HasArgument(const std::string &optionName) const;
+
+		/// Return the argument of an option, adding the option if not defined.
+		std::string &operator[](const std::string &optionName);
+
+		/// Return the argument of a defined option.
+		std::string &at(const std::string &optionName);
+		const std::string &at(const std::string &optionName) const;
+
+		/// Find an option, returning end() if it is not defined.
+		iterator find(const std::string &optionName);
+		const_iterator find(const std::string &optionName) const;
+
+		/// Remove an option, returning the number of removed options.
+		size_t erase(const std::string &optionName);
+
+		iterator begin() {return options_.begin();}
+		iterator end() {return options_.end();}
+		const_iterator begin() const {return options_.begin();}
+		const_iterator end() const {return options_.end();}
+		bool empty() const {return options_.empty();}
+		size_t size() const {return options_.size();}
 
 		/// Parse an option into name and argument.
 		static std::pair< std::string, std::string> ParseOption(const std::string &option);
@@ -26,7 +60,27 @@ class TikzOptions : public std::map< std::string, std::string > {
 		static std::string Strip(const std::string &str);
 
 		/// Get a string representation of the options.
-		std::string GetString();
+		std::string GetString() const;
+
+		/// Append the options one per line with the given indentation.
+		void AppendString(std::string &output,
+		                  const std::string &indent = "\t\t\t") const;
+
+	private:
+		/// The options in the order they were added.
+		std::vector< Option > options_;
+
+		/// Flags indicating the options given with an equal sign, in the same order.
+		std::vector< bool > hasArgument_;
+
+		/// Add a single option from the characters in the range [first, last).
+		void AddOption(const char *first, const char *last);
+
+		/// Remove options from the given index on that are already defined.
+		void RemoveDuplicates(const size_t &first);
+
+		/// The number of options above which duplicates are found with a hash set.
+		static const size_t kIndexSize = 16;
 };
 
 #endif // TIKZOPTIONS_HPP
@@ -0,0 +1,27 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZPARALLEL_HPP
+#define TIKZPARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+/**Runs a set of independent tasks on a group of worker threads. Each worker
+ * starts with a contiguous block of tasks and, once its own block is done,
+ * steals tasks from the end of the other workers' blocks. This balances the
+ * load when task costs vary widely, e.g. figures of very different size.
+ */
+class TikzParallel {
+	public:
+		/// Run the tasks 0 to nTasks - 1, returning once all are complete.
+		static void For(const size_t &nTasks, const unsigned int &nThreads,
+		                const std::function< void(const size_t&) > &task);
+
+		/// Return the number of threads to use for a requested number.
+		static unsigned int GetThreads(const unsigned int &nThreads);
+};
+
+#endif // TIKZPARALLEL_HPP
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "PgfPlotsAxis.hpp"
+#include "TikzReport.hpp"
 
 class TikzPicture {
 	public:
@@ -17,12 +18,51 @@ class TikzPicture {
 		/// Add an axis or group plot to this picture.
 		void Add(PgfPlotsAxis* obj);
 
+		/// Return the registered axes.
+		const std::vector< PgfPlotsAxis* > &GetAxes() {return axes_;}
+
 		/// Specify a colorbrewer2 palette to be used.
 		void SetPalette(std::string colorbrewer2_palette);
 
+		/// Write plot coordinates to table files next to the picture.
+		void SetExternalData(const bool &externalData = true) {externalData_ = externalData;}
+
+		/// Only write the picture if its content changed since the last write.
+		void SetIncremental(const bool &incremental = true) {incremental_ = incremental;}
+
+		/// Name the picture for the TikZ external library after its content.
+		void SetExternalize(const bool &externalize = true) {externalize_ = externalize;}
+
+		/// Write the cost report as JSON next to the picture file.
+		void SetReport(const bool &report = true) {report_ = report;}
+
+		/// Limit the coordinates written for the picture, zero disables.
+		void SetBudget(const size_t &coordinates) {budget_ = coordinates;}
+
+		/// Set the LaTeX code written between the pages of paginated group plots.
+		void SetPageBreak(const std::string &pageBreak) {pageBreak_ = pageBreak;}
+
+		/// Set the TeX main memory in words above which a warning is printed.
+		void SetTexMemory(const size_t &texMemory) {texMemory_ = texMemory;}
+
+		/// Return the cost of the last write of the picture.
+		const TikzReport::Picture &GetReport() {return pictureReport_;}
+
+		/// Return a hash of the content determining the written picture.
+		std::string GetHash();
+
 		/// Write the picture and registered axis and plots.
 		void Write(const std::string &filename = "");
 
+		/// Return the files written by Write to the given file, including itself.
+		std::vector< std::string > GetOutputFiles(const std::string &filename);
+
+		/// The version of the written TeX, to be increased whenever it changes.
+		static const unsigned int kFormatVersion = 3;
+
+		/// The typical bytes of an axis header and footer.
+		static const size_t kBytesPerAxis = 1024;
+
 	private:
 		/// The vector of registered axes.
 		std::vector< PgfPlotsAxis* > axes_;
@@ -35,6 +75,46 @@ class TikzPicture {
 
 		/// Additional preamble material.
 		std::string preamble_;
+
+		/// Flag indicating plot data is written to external tables.
+		bool externalData_;
+
+		/// Flag indicating unchanged pictures are not rewritten.
+		bool incremental_;
+
+		/// Flag indicating the picture is named for externalization.
+		bool externalize_;
+
+		/// Flag indicating the cost report is written to a file.
+		bool report_;
+
+		/// The TeX main memory in words above which a warning is printed.
+		size_t texMemory_;
+
+		/// The maximum number of coordinates, zero if unlimited.
+		size_t budget_;
+
+		/// The LaTeX code written between pages.
+		std::string pageBreak_;
+
+		/// The cost of the last write.
+		TikzReport::Picture pictureReport_;
+
+		/// Divide the budget among the plots, returning their previous budgets.
+		std::vector< std::pair< PgfPlotsPlot*, size_t > > DistributeBudget();
+
+		/// Return the file name of an external data table.
+		static std::string GetTableFile(const std::string &filename,
+		                                const unsigned int &tableId);
+
+		/// Estimate the size of the picture, used to size the output buffer.
+		size_t EstimateBytes();
+
+		/// Check if a file was written from content with the given hash.
+		bool IsUnchanged(const std::string &filename, const std::string &hash);
+
+		/// Write the preamble, picture and registered axes.
+		void WritePicture(std::streambuf *buf, const std::string &externalName);
 };
 
 #endif //TIKZPICTURE_HPP
@@ -40,11 +40,15 @@ class TikzPlot{
 		static void PlotTH2(const TH2* hist, const std::string &options,
 				std::streambuf *buf = std::cout.rdbuf());
 
+		/// Render a histogram to an image and write the addplot graphics command.
+		static void PlotImage(const TH2* hist, const std::string &imageName,
+				std::streambuf *buf = std::cout.rdbuf());
+
 		/// Switch specifying if ROOT should be used to render histogram contents.
 		void SetRootRender(const std::string &imageName);
 
 		/// Converts a ROOT TLatex string to a valid LaTeX string.
-		static std::string GetLatexString(std::string str);
+		static std::string GetLatexString(const std::string &str);
 
 		/// Specify a colorbrewer2 palette to be used.
 		void SetPalette(std::string colorbrewer2_palette);
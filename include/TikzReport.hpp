@@ -0,0 +1,112 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZREPORT_HPP
+#define TIKZREPORT_HPP
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**The cost of exporting a picture. The plots, axes and picture fill in their
+ * part of the report while being written, so after TikzPicture::Write the
+ * report shows which plot is responsible for a large file or a slow TeX
+ * compile. The TeX memory is a rough estimate of the main memory pgfplots
+ * needs to typeset the coordinates, used to warn before TeX fails with
+ * "TeX capacity exceeded".
+ */
+class TikzReport {
+	public:
+		/// The cost of a single plot.
+		struct Plot {
+			/// The name and class of the plotted object.
+			std::string name;
+			std::string type;
+			/// The representation of the data, e.g. full or decimated.
+			std::string strategy;
+			/// The bins or points of the plotted object.
+			size_t items;
+			/// The coordinates written.
+			size_t coordinates;
+			/// The bins or points not written as a coordinate of their own.
+			size_t suppressed;
+			/// The bytes written to the picture and to the external table.
+			size_t bytes;
+			size_t tableBytes;
+			/// Time spent writing the plot in seconds.
+			double seconds;
+			/// The estimated TeX main memory in words.
+			size_t texMemory;
+		};
+
+		/// The cost of an axis or group plot and its plots.
+		struct Axis {
+			/// The LaTeX command starting the environment.
+			std::string environment;
+			/// The bytes written including the plots.
+			size_t bytes;
+			/// Time spent processing the options in seconds.
+			double preprocessSeconds;
+			/// Time spent writing the axis including the plots in seconds.
+			double seconds;
+			/// The estimated TeX main memory in words.
+			size_t texMemory;
+			/// The plots in the order they are written.
+			std::vector< Plot > plots;
+		};
+
+		/// The cost of a picture.
+		struct Picture {
+			std::string filename;
+			/// Flag indicating the picture was unchanged and not written.
+			bool unchanged;
+			/// The bytes written to the picture file.
+			size_t bytes;
+			/// Time spent computing the content hash in seconds.
+			double hashSeconds;
+			/// Time spent writing the picture in seconds.
+			double seconds;
+			/// The estimated TeX main memory in words.
+			size_t texMemory;
+			std::vector< Axis > axes;
+		};
+
+		/// The default main memory of TeX in words.
+		static const size_t kTexMainMemory = 5000000;
+
+		/// Estimate the TeX main memory needed for the coordinates of a plot.
+		static size_t EstimateTexMemory(const size_t &coordinates,
+		                                const size_t &bytes);
+
+		/// Write a picture report as JSON.
+		static void WriteJson(const Picture &picture, std::ostream &output);
+
+		/// Write a string as a JSON string literal.
+		static void WriteJsonString(std::ostream &output, const std::string &str);
+
+		/// A streambuf counting the characters passed to another streambuf.
+		class CountingBuffer : public std::streambuf {
+			public:
+				CountingBuffer(std::streambuf *buf) : buf_(buf), count_(0) {}
+
+				/// Return the number of characters passed on.
+				size_t GetCount() const {return count_;}
+
+			protected:
+				int overflow(int c);
+				std::streamsize xsputn(const char *data, std::streamsize length);
+				int sync() {return buf_->pubsync();}
+
+			private:
+				/// The destination of the output.
+				std::streambuf *buf_;
+
+				/// The number of characters passed on.
+				size_t count_;
+		};
+};
+
+#endif // TIKZREPORT_HPP
@@ -0,0 +1,71 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ */
+
+#ifndef TIKZWRITER_HPP
+#define TIKZWRITER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**A small buffered writer used to emit plot output. Text and numbers are
+ * collected into a fixed size chunk which is handed to the underlying
+ * streambuf once full, so arbitrarily large plots are written with bounded
+ * memory and without the per insertion overhead of std::ostream.
+ */
+class TikzWriter {
+	public:
+		TikzWriter(std::streambuf *buf = std::cout.rdbuf(),
+		           const int &precision = 0);
+		~TikzWriter();
+
+		/// Set the number of significant digits used for doubles.
+		void SetPrecision(const int &precision) {precision_ = precision;}
+
+		/// Append a block of characters.
+		void Write(const char *data, const size_t &length);
+
+		/// Pass all buffered characters to the streambuf.
+		void Flush();
+
+		/// Return the number of characters written, including pending ones.
+		size_t GetBytes() const {return bytes_ + length_;}
+
+		/// Count coordinates written, used to report the cost of a plot.
+		void AddCoordinates(const size_t &coordinates = 1) {coordinates_ += coordinates;}
+
+		/// Return the number of coordinates counted.
+		size_t GetCoordinates() const {return coordinates_;}
+
+		TikzWriter& operator<<(const char *str);
+		TikzWriter& operator<<(const std::string &str);
+		TikzWriter& operator<<(const char &c);
+		TikzWriter& operator<<(const int &value);
+		TikzWriter& operator<<(const double &value);
+
+		/// The size of the chunks passed to the streambuf.
+		static const size_t kBufferSize = 1 << 16;
+
+	private:
+		/// The destination of the output.
+		std::streambuf *buf_;
+
+		/// The pending output.
+		std::vector< char > buffer_;
+
+		/// The number of pending characters.
+		size_t length_;
+
+		/// Significant digits for doubles, zero for shortest round trip.
+		int precision_;
+
+		/// The number of characters passed to the streambuf.
+		size_t bytes_;
+
+		/// The number of coordinates counted.
+		size_t coordinates_;
+};
+
+#endif // TIKZWRITER_HPP
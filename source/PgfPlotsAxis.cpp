@@ -1,7 +1,30 @@
 #include "PgfPlotsAxis.hpp"
 
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+
+#include "TikzLatex.hpp"
+#include "TikzNumber.hpp"
+
+const std::array< std::array< const char*, 2 >, 3 > PgfPlotsAxis::kLimitOptions = {{
+	{{"xmin", "xmax"}}, {{"ymin", "ymax"}}, {{"point meta min", "point meta max"}}
+}};
+
+PgfPlotsAxis::Range::Range()
+	: min(std::numeric_limits< double >::infinity()),
+	  max(-std::numeric_limits< double >::infinity())
+{
+
+}
+
+void PgfPlotsAxis::Range::Include(const double &low, const double &high) {
+	if (low < min) min = low;
+	if (high > max) max = high;
+}
+
 PgfPlotsAxis::PgfPlotsAxis(const std::string &options)
-	: legend_(nullptr)
+	: writeLimits_({{true, true, true}}), legend_(nullptr)
 {
 	options_.Add(options);
 }
@@ -10,7 +33,10 @@ void PgfPlotsAxis::SetLegend(PgfPlotsLegend *legend) {
 	legend_ = legend;
 }
 
-/** Add a plot to this axis.
+/** Add a plot to this axis. The axis limits are extended to include the
+ * plot. They are kept as numbers and only formatted when the axis is
+ * written, so adding many plots is cheap and small values keep their
+ * precision.
  *
  * \param[in] plot The plot to be added.
  */
@@ -44,20 +70,15 @@ void PgfPlotsAxis::AddPlot(PgfPlotsPlot *plot) {
 	}
 	//z-axis label.
 	if (hist2d && options_.find("colorbar style") == options_.end()) {
-		options_["view"] = "{0}{90}";
+		//Rendered images are placed in a two-dimensional axis.
+		if (plot->GetRenderImage() == "") options_["view"] = "{0}{90}";
+		else options_["axis on top"] = "true";
 		options_["colorbar"] = "true";
 		options_["colorbar style"] = "{ylabel={" + GetLatexString(zAxis->GetTitle()) + "}}";
 	}
 
 	//Get the x-axis limits.
-	std::string &xmin = options_["xmin"];
-	if (xmin == "" || std::stod(xmin) > xAxis->GetXmin()) {
-		xmin = std::to_string(xAxis->GetXmin());
-	}
-	std::string &xmax = options_["xmax"];
-	if (xmax == "" || std::stod(xmax) < xAxis->GetXmax()) {
-		xmax = std::to_string(xAxis->GetXmax());
-	}
+	ranges_[0].Include(xAxis->GetXmin(), xAxis->GetXmax());
 
 	//Get the y-axis limits
 	double plotYMin = yAxis->GetXmin();
@@ -69,15 +90,7 @@ void PgfPlotsAxis::AddPlot(PgfPlotsPlot *plot) {
 		plotYMin *= 0.9;
 		plotYMax *= 1.1;
 	}
-
-	std::string &ymin = options_["ymin"];
-	if (ymin == "" || std::stod(ymin) > plotYMin) {
-		ymin = std::to_string(plotYMin);
-	}
-	std::string &ymax = options_["ymax"];
-	if (ymax == "" || std::stod(ymax) < plotYMax) {
-		ymax = std::to_string(plotYMax);
-	}
+	ranges_[1].Include(plotYMin, plotYMax);
 
 	//Get the z-axis limits
 	if (zAxis) {
@@ -86,10 +99,69 @@ void PgfPlotsAxis::AddPlot(PgfPlotsPlot *plot) {
 		if (hist2d) {
 			hist2d->GetMinimumAndMaximum(plotZMin, plotZMax);
 		}
-		options_["point meta min"] = std::to_string(plotZMin);
-		options_["point meta max"] = std::to_string(plotZMax);
-		options_["restrict z to domain*"] = std::to_string(plotZMin) + ":"
-		                                    + std::to_string(plotZMax);
+		ranges_[2].Include(plotZMin, plotZMax);
+	}
+}
+
+/** Limits given in the options take precedence over the range of the plots.
+ * Options which are not a plain number give a NaN limit.
+ *
+ * \param[in] axis The axis: x=0, y=1, point meta=2.
+ * \return The limits of the axis, unset if there are none.
+ */
+PgfPlotsAxis::Range PgfPlotsAxis::GetLimits(const short &axis) {
+	Range limits = ranges_.at(axis);
+	for (short bound = 0; bound < 2; bound++) {
+		auto option = options_.find(kLimitOptions[axis][bound]);
+		if (option == options_.end()) continue;
+
+		const char *begin = option->second.c_str();
+		char *end;
+		double value = std::strtod(begin, &end);
+		if (end == begin || *end != '\0') value = std::numeric_limits< double >::quiet_NaN();
+		if (bound == 0) limits.min = value;
+		else limits.max = value;
+	}
+	return limits;
+}
+
+/**
+ * \param[in] axis The axis: x=0, y=1, point meta=2.
+ * \param[in] writeLimits Flag indicating the limits are written.
+ */
+void PgfPlotsAxis::SetWriteLimits(const short &axis, const bool &writeLimits) {
+	writeLimits_.at(axis) = writeLimits;
+}
+
+/** The limits of the plots are formatted with the shortest representation
+ * reproducing the values. Limits set by the options are written with the
+ * options. The point meta range also restricts the z values of the plots.
+ *
+ * \param[out] header The environment header the limits are appended to.
+ */
+void PgfPlotsAxis::AppendLimits(std::string &header) {
+	char number[TikzNumber::kMaxLength];
+	for (short axis = 0; axis < 3; axis++) {
+		const Range &range = ranges_[axis];
+		if (!writeLimits_[axis] || !range.IsSet()) continue;
+		for (short bound = 0; bound < 2; bound++) {
+			if (options_.IsDefined(kLimitOptions[axis][bound])) continue;
+			header.append("\t\t\t");
+			header.append(kLimitOptions[axis][bound]);
+			header.push_back('=');
+			header.append(number, TikzNumber::Format(bound ? range.max : range.min, number));
+			header.append(",\n");
+		}
+	}
+
+	if (writeLimits_[2] && ranges_[2].IsSet()
+		&& !options_.IsDefined("restrict z to domain*"))
+	{
+		header.append("\t\t\trestrict z to domain*=");
+		header.append(number, TikzNumber::Format(ranges_[2].min, number));
+		header.push_back(':');
+		header.append(number, TikzNumber::Format(ranges_[2].max, number));
+		header.append(",\n");
 	}
 }
 
@@ -122,78 +194,126 @@ void PgfPlotsAxis::SetLog(const short &axis, const bool &logMode /* = true */) {
 	}
 }
 
-/** Write the axis and its registered plots to the specified buffer.
+/** Add the content of the axis to a hash. The options are added as set by
+ * the user and the plots, as the preprocessing only depends on these.
+ *
+ * \param[in] hash The hash receiving the axis content.
+ */
+void PgfPlotsAxis::Hash(TikzHash &hash) {
+	hash.Add(EnvHeader());
+	hash.Add(options_.GetString());
+	hash.AddValue(legend_ != nullptr);
+	if (legend_) legend_->Hash(hash);
+	hash.AddValue(plots_.size());
+	for (auto plot : plots_) {
+		plot->Hash(hash);
+	}
+}
+
+/** Write the axis and its registered plots to the specified buffer. The cost
+ * of the write and the reports of the plots are recorded in the report, see
+ * GetReport.
  *
  * \param[in] buf The buffer that the plot should be written into.
  */
 void PgfPlotsAxis::Write(std::streambuf *buf) {
+	auto start = std::chrono::steady_clock::now();
+	report_ = TikzReport::Axis();
+	report_.environment = EnvHeader();
+
 	PreprocessOptions();
+	report_.preprocessSeconds = std::chrono::duration< double >(
+		std::chrono::steady_clock::now() - start).count();
 
-	std::ostream output(buf);
+	TikzReport::CountingBuffer counter(buf);
+	buf = &counter;
 
-	output << "\t" << EnvHeader() << "[\n";
+	//The environment header is collected and written in one piece.
+	const std::string header = GetHeader();
+	buf->sputn(header.data(), header.size());
 
-	for (auto option : options_) {
-		output << "\t\t\t" << option.first << "=" << option.second << ",\n";
+	// Write the optional legend.
+	if (legend_) legend_->Write(buf);
+
+	WriteRegisteredItems(buf);
+
+	const std::string footer = "\t" + EnvFooter() + "\n";
+	buf->sputn(footer.data(), footer.size());
+
+	for (auto plot : GetWrittenPlots()) {
+		report_.plots.push_back(plot->GetReport());
 	}
+	report_.texMemory = EstimateTexMemory();
+	report_.bytes = counter.GetCount();
+	report_.seconds = std::chrono::duration< double >(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+/** The header contains the options, the limits and the legend style.
+ *
+ * \return The header of the environment.
+ */
+std::string PgfPlotsAxis::GetHeader() {
+	std::string header = "\t" + EnvHeader() + "[\n";
+	AppendOptions(header);
 
 	// Write any legend options for the specified legend
 	if (legend_) {
 		auto legendStyle = legend_->GetStyle();
 		if (!legendStyle->empty()) {
-			output << "\t\t\tlegend style={\n";
-			for (auto option : *legendStyle) {
-				output << "\t\t\t\t" << option.first << "=" << option.second << ",\n";
-			}
-			output << "\t\t\t}\n";
+			header.append("\t\t\tlegend style={\n");
+			legendStyle->AppendString(header, "\t\t\t\t");
+			header.append("\t\t\t}\n");
 		}
 	}
 
-	output << "\t\t]\n\n";
-
-	// Write the optional legend.
-	if (legend_) legend_->Write(buf);
+	header.append("\t\t]\n\n");
+	return header;
+}
 
-	WriteRegisteredItems(buf);
+/**
+ * \param[out] header The environment header the options are appended to.
+ */
+void PgfPlotsAxis::AppendOptions(std::string &header) {
+	options_.AppendString(header);
+	AppendLimits(header);
+}
 
-	output << "\t" << EnvFooter() << "\n";
+/** pgfplots keeps the coordinates of all plots of an axis until the axis is
+ * complete, thus the memory of the plots adds up.
+ *
+ * \return The estimated main memory in words.
+ */
+size_t PgfPlotsAxis::EstimateTexMemory() {
+	size_t texMemory = 0;
+	for (auto plot : plots_) {
+		texMemory += plot->GetReport().texMemory;
+	}
+	return texMemory;
 }
 
-/** Write the registered plots to the specified buffer.
+/** Write the registered plots to the specified buffer. The plots are given
+ * the point meta range of the axis, which the colors of rendered images are
+ * mapped to.
  *
- * \param[in] buf The buffer that the plot should be written into.
+ * \param[in] buf The buffer that the plots should be written into.
  */
 void PgfPlotsAxis::WriteRegisteredItems(std::streambuf *buf) {
+	const Range metaRange = sharedMetaRange_.IsSet() ? sharedMetaRange_ : GetLimits(2);
 	for (auto plot : plots_) {
+		plot->SetMetaRange(metaRange.min, metaRange.max);
 		plot->Write(buf);
 	}
 }
 
 
-/** Convert ROOT TLatex syntax into proper LaTeX syntax.
+/** Convert ROOT TLatex syntax into proper LaTeX syntax, see
+ * TikzLatex::Translate. Conversions are cached.
  *
- * \param[in] A ROOT TLatex string to be converted.
+ * \param[in] str A ROOT TLatex string to be converted.
  * \return A LaTeX formatted string.
  */
-std::string PgfPlotsAxis::GetLatexString(std::string str) {
-	//Replace # with \ and wrap in $.
-	std::size_t loc = str.find_first_of("#");
-	while (loc != std::string::npos) {
-		str[loc] = '\\';
-		str.insert(loc++, "$");
-		loc = str.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ", loc+1);
-		str.insert(loc, "$");
-		loc = str.find_first_of("#", loc);
-	}
-	//Wrap math commands in $
-	loc = str.find_first_of("{");
-	while (loc != std::string::npos) {
-		loc = str.find_last_of(" \\^_", loc);
-		str.insert(loc++, "$");
-		loc = str.find_first_of("}", loc+1);
-		str.insert(++loc, "$");
-		loc = str.find_first_of("{", loc);
-	}
-	return str;
+std::string PgfPlotsAxis::GetLatexString(const std::string &str) {
+	return TikzLatex::Get(str);
 }
 
@@ -1,14 +1,27 @@
 #include "PgfPlotsGroupPlot.hpp"
 
+#include <algorithm>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
 
+#include "TikzDocument.hpp"
+#include "TikzParallel.hpp"
+
+/** The grid dimensions are kept separately from the options. Any further
+ * group style given in the options, e.g. the separation of the plots, is
+ * merged into the group style and written after the dimensions.
+ */
 PgfPlotsGroupPlot::PgfPlotsGroupPlot(unsigned int rows,
 												 unsigned int columns, std::string options)
-	: PgfPlotsAxis(options), globalAxisLimits_({false})
+	: PgfPlotsAxis(options), rows_(rows), columns_(columns), pageRows_(0),
+	  page_(0), document_(nullptr), globalAxisLimits_({false}), nThreads_(1)
 {
-	options_["group style"] = "{rows=" + std::to_string(rows)
-									  + ", columns=" + std::to_string(columns) + "}";
+	auto groupStyle = options_.find("group style");
+	if (groupStyle != options_.end()) {
+		MergeGroupStyle(groupStyle->second);
+		options_.erase("group style");
+	}
 	subPlots_.resize(rows * columns, nullptr);
 }
 
@@ -21,20 +34,96 @@ void PgfPlotsGroupPlot::AddPlot(PgfPlotsPlot *plot, unsigned int plotId) {
 	GetSubPlot(plotId)->AddPlot(plot);
 }
 
+/** Collect the plots registered to the sub plots in the order they are
+ * written.
+ *
+ * \return A vector of the plots.
+ */
+std::vector< PgfPlotsPlot* > PgfPlotsGroupPlot::GetPlots() {
+	std::vector< PgfPlotsPlot* > plots;
+	for (auto subPlot : subPlots_) {
+		if (!subPlot) continue;
+		auto subPlotPlots = subPlot->GetPlots();
+		plots.insert(plots.end(), subPlotPlots.begin(), subPlotPlots.end());
+	}
+	return plots;
+}
+
 /** Return the group plot arrangement, the number of rows anc columns.
  */
 const std::pair< unsigned short, unsigned short > PgfPlotsGroupPlot::GetPlotDims() {
-	//Get the group style options.
-	std::string &groupStyleStr = options_["group style"];
-	TikzOptions groupStyle(groupStyleStr.substr(1, groupStyleStr.length() - 2));
-	const int rows = std::stoi(groupStyle["rows"]);
-	const int columns = std::stoi(groupStyle["columns"]);
+	return std::make_pair(rows_, columns_);
+}
+
+/** Options given later override earlier ones. The dimensions of the grid
+ * are set by the constructor and cannot be changed.
+ *
+ * \param[in] groupStyle The group style options, with or without braces.
+ */
+void PgfPlotsGroupPlot::SetGroupStyle(const std::string &groupStyle) {
+	MergeGroupStyle(groupStyle);
+}
+
+void PgfPlotsGroupPlot::MergeGroupStyle(const std::string &groupStyle) {
+	TikzOptions style;
+	if (groupStyle.size() >= 2 && groupStyle.front() == '{'
+		&& groupStyle.back() == '}')
+	{
+		style.Add(groupStyle.substr(1, groupStyle.size() - 2));
+	}
+	else style.Add(groupStyle);
+
+	for (auto &option : style) {
+		if (option.first == "rows" || option.first == "columns") continue;
+		groupStyle_.erase(option.first);
+		if (style.HasArgument(option.first)) groupStyle_[option.first] = option.second;
+		else groupStyle_.Add(option.first);
+	}
+}
+
+/** Very large grids overwhelm TeX when typeset as a single group plot. With
+ * pagination each page of rows is written as its own group plot by the
+ * TikzPicture, which starts a new tikzpicture environment for every page.
+ *
+ * \return The number of pages, one if the grid is not split.
+ */
+unsigned int PgfPlotsGroupPlot::GetPages() {
+	if (!pageRows_ || rows_ <= pageRows_) return 1;
+	return (rows_ + pageRows_ - 1) / pageRows_;
+}
+
+/** The labels, tick labels and global limits are determined for the whole
+ * grid whichever page is written.
+ *
+ * \param[in] page The page to be written, starting from zero.
+ */
+void PgfPlotsGroupPlot::SetPage(const unsigned int &page) {
+	if (page >= GetPages())
+		throw std::runtime_error("ERROR: Invalid page, " + std::to_string(page) + "!");
+	page_ = page;
+}
+
+std::pair< size_t, size_t > PgfPlotsGroupPlot::GetPageSubPlots() {
+	if (GetPages() == 1) return std::make_pair(size_t(0), subPlots_.size());
+	const size_t pageSize = pageRows_ * columns_;
+	return std::make_pair(page_ * pageSize,
+		std::min((page_ + 1) * pageSize, subPlots_.size()));
+}
 
-	return std::make_pair(rows, columns);
+std::vector< PgfPlotsPlot* > PgfPlotsGroupPlot::GetWrittenPlots() {
+	const auto range = GetPageSubPlots();
+	std::vector< PgfPlotsPlot* > plots;
+	for (size_t index = range.first; index < range.second; index++) {
+		if (!subPlots_[index]) continue;
+		auto subPlotPlots = subPlots_[index]->GetPlots();
+		plots.insert(plots.end(), subPlotPlots.begin(), subPlotPlots.end());
+	}
+	return plots;
 }
 
 /** Get a pointer to the specified sub plot. This method will create the sub
- * plot object if it does not exist.
+ * plot object if it does not exist. Created sub plots are owned by the group
+ * plot, or by its document if it was created by a TikzDocument.
  *
  * \param[in] plotId the sub plot id to get the pointer for.
  * \return The sub plot pointer.
@@ -46,7 +135,11 @@ PgfPlotsGroupSubPlot* PgfPlotsGroupPlot::GetSubPlot(unsigned int plotId) {
 	PgfPlotsGroupSubPlot* &subPlot = subPlots_.at(plotId);
 
 	//If there is no sub plot defined at that position we create it.
-	if (! subPlot) subPlot = new PgfPlotsGroupSubPlot();
+	if (! subPlot && document_) subPlot = document_->New< PgfPlotsGroupSubPlot >();
+	else if (! subPlot) {
+		ownedSubPlots_.emplace_back(new PgfPlotsGroupSubPlot());
+		subPlot = ownedSubPlots_.back().get();
+	}
 
 	return subPlot;
 }
@@ -60,7 +153,21 @@ void PgfPlotsGroupPlot::SetSubPlot(unsigned int plotId,
 	subPlots_.at(plotId) = subPlot;
 }
 
+/** The preprocessing runs on every write, and thus on every page. The
+ * options added by the previous run are removed first so that each run sees
+ * only the options of the user and every page is written alike.
+ */
 void PgfPlotsGroupPlot::PreprocessOptions() {
+	for (auto &name : preprocessedOptions_) options_.erase(name);
+	preprocessedOptions_.clear();
+
+	//A group style added to the options after construction is merged as well.
+	auto groupStyle = options_.find("group style");
+	if (groupStyle != options_.end()) {
+		MergeGroupStyle(groupStyle->second);
+		options_.erase("group style");
+	}
+
 	ProcessGlobalLimits();
 	ProcessAxisLabels();
 	//Tick labels should be done after global limits.
@@ -68,21 +175,23 @@ void PgfPlotsGroupPlot::PreprocessOptions() {
 }
 
 void PgfPlotsGroupPlot::ProcessTickLabels() {
-	auto dimensions = GetPlotDims();
-	unsigned short &rows = dimensions.first;
-	unsigned short &columns = dimensions.second;
+	const unsigned int rows = rows_;
+	const unsigned int columns = columns_;
 
 	//Determine column and row labels
-	std::vector< std::pair< std::string, std::string > > columnLimits(columns);
-	std::vector< std::pair< std::string, std::string > > rowLimits(rows);
+	std::vector< Range > columnLimits(columns);
+	std::vector< Range > rowLimits(rows);
 	bool identicalColumnLimits = true;
 	bool identicalRowLimits = true;
 
-	auto blankLimits = make_pair(std::string(), std::string());
+	//Global limits are shared by all sub plots.
+	auto SubPlotLimits = [&](PgfPlotsGroupSubPlot *subPlot, const short &axis) {
+		return globalAxisLimits_[axis] ? GetLimits(axis) : subPlot->GetLimits(axis);
+	};
 
-	for (int row=0; row < rows; ++row) {
-		for (int column=0; column < columns; ++column) {
-			auto subPlot = subPlots_.at(columns * row + column);
+	for (unsigned int row=0; row < rows; ++row) {
+		for (unsigned int column=0; column < columns; ++column) {
+			auto subPlot = subPlots_[columns * row + column];
 			if (!subPlot) {
 				if (row == rows - 1) {
 					identicalColumnLimits = false;
@@ -93,18 +202,14 @@ void PgfPlotsGroupPlot::ProcessTickLabels() {
 				continue;
 			}
 
-			auto plotOptions = subPlot->GetOptions();
-
 			//Handle column labels (x-axis);
-			const auto xlimits = std::make_pair(plotOptions->at("xmin"),
-													 plotOptions->at("xmax"));
-			if (columnLimits[column] == blankLimits) columnLimits[column] = xlimits;
+			const Range xlimits = SubPlotLimits(subPlot, 0);
+			if (!columnLimits[column].IsSet()) columnLimits[column] = xlimits;
 			else if (columnLimits[column] != xlimits) identicalColumnLimits = false;
 
 			//Handle row labels (y-axis);
-			const auto ylimits = std::make_pair(plotOptions->at("ymin"),
-													 plotOptions->at("ymax"));
-			if (rowLimits[row] == blankLimits) rowLimits[row] = ylimits;
+			const Range ylimits = SubPlotLimits(subPlot, 1);
+			if (!rowLimits[row].IsSet()) rowLimits[row] = ylimits;
 			else if (rowLimits[row] != ylimits) identicalRowLimits = false;
 		}
 	}
@@ -119,27 +224,33 @@ void PgfPlotsGroupPlot::ProcessTickLabels() {
 
 	//Set the global tick labels
 	if (identicalColumnLimits) {
-		options_.Add("group/xticklabels at=edge bottom");
+		AddPreprocessedOption("group/xticklabels at", "edge bottom");
 	}
 	if (identicalRowLimits) {
-		options_.Add("group/yticklabels at=edge left");
+		AddPreprocessedOption("group/yticklabels at", "edge left");
 	}
 }
 
 void PgfPlotsGroupPlot::ProcessAxisLabels() {
-	auto dimensions = GetPlotDims();
-	unsigned short &rows = dimensions.first;
-	unsigned short &columns = dimensions.second;
+	const unsigned int rows = rows_;
+	const unsigned int columns = columns_;
 
-	//Determine column and row labels
-	std::vector<std::string> columnLabels(columns);
-	std::vector<std::string> rowLabels(rows);
+	//Determine column and row labels, pointing to the sub plot options.
+	static const std::string noLabel;
+	std::vector< const std::string* > columnLabels(columns, &noLabel);
+	std::vector< const std::string* > rowLabels(rows, &noLabel);
 	bool identicalColumnLabels = true;
 	bool identicalRowLabels = true;
 
-	for (int row=0; row < rows; ++row) {
-		for (int column=0; column < columns; ++column) {
-			auto subPlot = subPlots_.at(columns * row + column);
+	//The labels are removed once moved to the group by a previous write.
+	auto Label = [&](TikzOptions *plotOptions, const char *name) {
+		auto option = plotOptions->find(name);
+		return option != plotOptions->end() ? &option->second : &noLabel;
+	};
+
+	for (unsigned int row=0; row < rows; ++row) {
+		for (unsigned int column=0; column < columns; ++column) {
+			auto subPlot = subPlots_[columns * row + column];
 			if (!subPlot) {
 				if (row == rows - 1) {
 					identicalColumnLabels = false;
@@ -151,15 +262,16 @@ void PgfPlotsGroupPlot::ProcessAxisLabels() {
 			}
 
 			//Handle column labels (x-axis);
-			const auto &xlabel = subPlot->GetOptions()->at("xlabel");
-			if (columnLabels[column] == "") columnLabels[column] = xlabel;
-			else if (xlabel != "" && columnLabels[column] != xlabel)
+			auto plotOptions = subPlot->GetOptions();
+			const std::string *xlabel = Label(plotOptions, "xlabel");
+			if (columnLabels[column]->empty()) columnLabels[column] = xlabel;
+			else if (!xlabel->empty() && *columnLabels[column] != *xlabel)
 				identicalColumnLabels = false;
 
 			//Handle row labels (y-axis);
-			const auto &ylabel = subPlot->GetOptions()->at("ylabel");
-			if (rowLabels[row] == "") rowLabels[row] = ylabel;
-			else if (ylabel != "" && rowLabels[row] != ylabel)
+			const std::string *ylabel = Label(plotOptions, "ylabel");
+			if (rowLabels[row]->empty()) rowLabels[row] = ylabel;
+			else if (!ylabel->empty() && *rowLabels[row] != *ylabel)
 				identicalRowLabels = false;
 		}
 	}
@@ -167,10 +279,10 @@ void PgfPlotsGroupPlot::ProcessAxisLabels() {
 	//Currently cannot handle different labels for different columns or rows,
 	//but this could be corrected in the future.
 	for (auto label : columnLabels) {
-		if (label != "" && label != columnLabels[0]) identicalColumnLabels = false;
+		if (!label->empty() && *label != *columnLabels[0]) identicalColumnLabels = false;
 	}
 	for (auto label : rowLabels) {
-		if (label != "" && label != rowLabels[0]) identicalRowLabels = false;
+		if (!label->empty() && *label != *rowLabels[0]) identicalRowLabels = false;
 	}
 
 	//If the user has defined how to handle this we ignore the fact that they are identical.
@@ -181,14 +293,14 @@ void PgfPlotsGroupPlot::ProcessAxisLabels() {
 		identicalRowLabels = false;
 	}
 
-	//Set the global labels
+	//Set the global labels, copied before the sub plot labels are removed.
 	if (identicalColumnLabels)  {
-		options_.Add("xlabel=" + columnLabels[0]);
-		options_.Add("group/xlabels at=edge bottom");
+		if (!options_.IsDefined("xlabel")) options_["xlabel"] = *columnLabels[0];
+		AddPreprocessedOption("group/xlabels at", "edge bottom");
 	}
 	if (identicalRowLabels) {
-		options_.Add("ylabel=" + rowLabels[0]);
-		options_.Add("group/ylabels at=edge left");
+		if (!options_.IsDefined("ylabel")) options_["ylabel"] = *rowLabels[0];
+		AddPreprocessedOption("group/ylabels at", "edge left");
 	}
 
 	//Remove plot specific labels to avoid rendering for identical case.
@@ -200,58 +312,58 @@ void PgfPlotsGroupPlot::ProcessAxisLabels() {
 	}
 
 	//Determine if spacing needs to be increased.
-	if (!identicalColumnLabels) options_.Add("group/vertical sep=2cm");
-	if (!identicalRowLabels) options_.Add("group/horizontal sep=2cm");
+	if (!identicalColumnLabels) AddPreprocessedOption("group/vertical sep", "2cm");
+	if (!identicalRowLabels) AddPreprocessedOption("group/horizontal sep", "2cm");
+}
+
+/**
+ * \param[in] name The name of the option.
+ * \param[in] value The argument of the option.
+ */
+void PgfPlotsGroupPlot::AddPreprocessedOption(const std::string &name,
+                                              const std::string &value)
+{
+	if (options_.IsDefined(name)) return;
+	options_[name] = value;
+	preprocessedOptions_.push_back(name);
 }
 
 
+/** Merge the limits of the sub plots for the axes with global limits. The
+ * merged limits are written by the group plot and the sub plots no longer
+ * write their own. If the group plot options set a limit of an axis no
+ * limits are computed for it.
+ */
 void PgfPlotsGroupPlot::ProcessGlobalLimits() {
 	for (short axis=0; axis<3; axis++) {
+		ranges_[axis] = Range();
+		for (auto subPlot : subPlots_) {
+			if (!subPlot) continue;
+			subPlot->SetWriteLimits(axis, !globalAxisLimits_[axis]);
+			if (axis == 2) subPlot->SetSharedMetaRange(Range());
+		}
 		if (!globalAxisLimits_[axis]) continue;
 
-		//Determine the option name
-		std::string axisLetter;
-		if (axis == 0) axisLetter = "x";
-		else if (axis == 1) axisLetter = "y";
-		else if (axis == 2) axisLetter = "z";
-		std::string minOptName = axisLetter + "min";
-		std::string maxOptName = axisLetter + "max";
-
-		std::string	&globalMin = options_[minOptName];
-		std::string	&globalMax = options_[maxOptName];
-
-		bool computeLimits = false;
 		//No global limits specified so we compute them.
-		if (globalMin == "" && globalMax == "") computeLimits = true;
+		if (options_.IsDefined(kLimitOptions[axis][0])
+			|| options_.IsDefined(kLimitOptions[axis][1])) continue;
 
 		for (auto subPlot : subPlots_) {
 			if (!subPlot) continue;
-			auto plotOptions = subPlot->GetOptions();
-
-			if (computeLimits) {
-				if (plotOptions->IsDefined(minOptName)) {
-					std::string	&min = plotOptions->at(minOptName);
-
-					if (globalMin == ""
-							|| (min != "" && std::stod(min) < std::stod(globalMin))) {
-						globalMin = min;
-					}
-				}
-				if (plotOptions->IsDefined(maxOptName)) {
-					std::string	&max = plotOptions->at(maxOptName);
-					if (globalMax == ""
-							|| (max != "" && std::stod(max) > std::stod(globalMax))) {
-						globalMax = max;
-					}
-				}
-			}
+			const Range limits = subPlot->GetLimits(axis);
+			if (limits.IsSet()) ranges_[axis].Include(limits.min, limits.max);
+		}
+	}
 
-			//Remove subplot limits
-			plotOptions->erase(minOptName);
-			plotOptions->erase(maxOptName);
+	//Rendered images of the sub plots use the colors of the shared color bar.
+	if (globalAxisLimits_[2]) {
+		const Range metaRange = GetLimits(2);
+		for (auto subPlot : subPlots_) {
+			if (subPlot) subPlot->SetSharedMetaRange(metaRange);
 		}
 	}
 }
+
 void PgfPlotsGroupPlot::SetGlobalAxisLimits(short axis, bool limitGlobally) {
 	if (axis > 2) {
 		throw std::runtime_error("Invalid axis, " + std::to_string(axis) + "!");
@@ -268,19 +380,117 @@ void PgfPlotsGroupPlot::SetGlobalAxisLimits(short axis, bool limitGlobally) {
 	globalAxisLimits_[axis] = limitGlobally;
 }
 
-/** Write the registered plots to the specified buffer.
+/** Add the group plot, the global limit settings and every sub plot in
+ * order to a hash. Missing sub plots are marked as place holders.
+ *
+ * \param[in] hash The hash receiving the group plot content.
+ */
+void PgfPlotsGroupPlot::Hash(TikzHash &hash) {
+	PgfPlotsAxis::Hash(hash);
+	hash.AddValue(rows_);
+	hash.AddValue(columns_);
+	hash.Add(groupStyle_.GetString());
+	hash.AddValue(pageRows_);
+	for (auto limitGlobally : globalAxisLimits_) {
+		hash.AddValue(limitGlobally);
+	}
+	hash.AddValue(subPlots_.size());
+	for (auto subPlot : subPlots_) {
+		hash.AddValue(subPlot != nullptr);
+		if (subPlot) subPlot->Hash(hash);
+	}
+}
+
+/** The group style gives the dimensions of the page being written.
+ *
+ * \param[out] header The environment header the options are appended to.
+ */
+void PgfPlotsGroupPlot::AppendOptions(std::string &header) {
+	unsigned int rows = rows_;
+	if (GetPages() > 1) rows = std::min(pageRows_, rows_ - page_ * pageRows_);
+
+	header.append("\t\t\tgroup style={rows=");
+	header.append(std::to_string(rows));
+	header.append(", columns=");
+	header.append(std::to_string(columns_));
+	for (auto &option : groupStyle_) {
+		header.append(", ");
+		header.append(option.first);
+		if (groupStyle_.HasArgument(option.first)) {
+			header.push_back('=');
+			header.append(option.second);
+		}
+	}
+	header.append("},\n");
+
+	PgfPlotsAxis::AppendOptions(header);
+}
+
+/** Write the sub plots of the current page to the specified buffer.
  *
  * \param[in] buf The buffer that the plot should be written into.
  */
 void PgfPlotsGroupPlot::WriteRegisteredItems(std::streambuf *buf) {
-	for (auto subPlot : subPlots_) {
-		if (subPlot) subPlot->Write(buf);
-		else WriteSubPlotPlaceHolder(buf);
+	const auto range = GetPageSubPlots();
+	WriteSubPlots(buf, range.first, range.second);
+}
+
+/** If more than one thread is used the sub plots are written concurrently
+ * into separate buffers which are then written out in order, producing the
+ * same output as the sequential case. The sub plots are processed in groups
+ * of a few per thread to limit the memory held in the buffers.
+ *
+ * \param[in] buf The buffer that the plot should be written into.
+ * \param[in] first The first sub plot to be written.
+ * \param[in] last One past the last sub plot to be written.
+ */
+void PgfPlotsGroupPlot::WriteSubPlots(std::streambuf *buf, const size_t &first,
+                                      const size_t &last)
+{
+	const unsigned int nThreads = TikzParallel::GetThreads(nThreads_);
+	if (nThreads == 1) {
+		for (size_t index = first; index < last; index++) {
+			if (subPlots_[index]) subPlots_[index]->Write(buf);
+			else WriteSubPlotPlaceHolder(buf);
+		}
+		return;
+	}
+
+	const size_t groupSize = 4 * nThreads;
+	std::vector< std::string > outputs;
+	for (size_t groupFirst = first; groupFirst < last; groupFirst += groupSize) {
+		const size_t nSubPlots = std::min(groupSize, last - groupFirst);
+		outputs.assign(nSubPlots, "");
+		TikzParallel::For(nSubPlots, nThreads, [&](const size_t &index) {
+			std::stringbuf output;
+			auto subPlot = subPlots_[groupFirst + index];
+			if (subPlot) subPlot->Write(&output);
+			else WriteSubPlotPlaceHolder(&output);
+			outputs[index] = output.str();
+		});
+		for (auto &output : outputs) {
+			buf->sputn(output.data(), output.size());
+		}
+	}
+}
+
+/** Each sub plot is a separate axis whose memory is released once it is
+ * complete, thus the largest sub plot determines the memory needed.
+ *
+ * \return The estimated main memory in words.
+ */
+size_t PgfPlotsGroupPlot::EstimateTexMemory() {
+	const auto range = GetPageSubPlots();
+	size_t texMemory = 0;
+	for (size_t index = range.first; index < range.second; index++) {
+		if (!subPlots_[index]) continue;
+		texMemory = std::max(texMemory, subPlots_[index]->GetReport().texMemory);
 	}
+	return texMemory;
 }
 
 void PgfPlotsGroupPlot::WriteSubPlotPlaceHolder(std::streambuf *buf) {
-	std::ostream output(buf);
-	output << "\t\t\\nextgroupplot[group/empty plot]\n";
+	static const std::string placeHolder = "\t\t\\nextgroupplot[group/empty plot]\n";
+	buf->sputn(placeHolder.data(), placeHolder.size());
 }
 
@@ -8,15 +8,23 @@ void PgfPlotsLegend::AddEntry(const std::string &entry) {
 	legendEntries_.push_back(entry);
 }
 
-void PgfPlotsLegend::Write(std::streambuf *buf) {
-	std::ostream output(buf);
-
-	output << "\t\\legend{\n";
-
+void PgfPlotsLegend::Hash(TikzHash &hash) {
+	hash.AddValue(legendEntries_.size());
 	for (auto entry : legendEntries_) {
-		output << "\t\t{" << entry << "},\n";
+		hash.Add(entry);
 	}
+	hash.Add(style_.GetString());
+}
 
-	output << "\t}\n";
+void PgfPlotsLegend::Write(std::streambuf *buf) {
+	std::string legend = "\t\\legend{\n";
+
+	for (auto &entry : legendEntries_) {
+		legend.append("\t\t{");
+		legend.append(entry);
+		legend.append("},\n");
+	}
 
+	legend.append("\t}\n");
+	buf->sputn(legend.data(), legend.size());
 }
@@ -1,11 +1,42 @@
 #include "PgfPlotsPlot.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
 
+#include <TArrayC.h>
+#include <TArrayD.h>
+#include <TArrayF.h>
+#include <TArrayI.h>
+#include <TArrayS.h>
+#include <TProfile.h>
+
+#include "PgfPlotsReduction.hpp"
+#include "TikzImage.hpp"
+#include "TikzNumber.hpp"
+#include "TikzParallel.hpp"
+#include "TikzWriter.hpp"
+
+namespace {
+	/// The TH2 occupancy below which patches are used to fit a budget, where
+	/// patches are used whenever they are cheaper than the full matrix.
+	const double kBudgetSparseThreshold = 0.25;
+
+	/// Check if the bins of an axis all have the same width.
+	bool IsUniform(const TAxis *axis) {
+		return axis->GetXbins()->GetSize() == 0;
+	}
+}
+
 PgfPlotsPlot::PgfPlotsPlot(const TH1* hist, const std::string &rootStyle,
                            const std::string &options)
-	: obj_(hist), options_(options), rootStyle_(rootStyle)
+	: obj_(hist), options_(options), rootStyle_(rootStyle), precision_(0),
+	  metaMin_(NAN), metaMax_(NAN), resolution_(0), rebinMode_(kEnvelope),
+	  sparseThreshold_(0.2), sparseThresholdSet_(false), budgetMergeX_(1),
+	  budgetMergeY_(1), compact_(true), nThreads_(1), budget_(0)
 {
 	if (!hist) {
 		throw std::runtime_error("ERROR: Null histogram pointer!");
@@ -14,7 +45,10 @@ PgfPlotsPlot::PgfPlotsPlot(const TH1* hist, const std::string &rootStyle,
 
 PgfPlotsPlot::PgfPlotsPlot(const TGraph* graph, const std::string &rootStyle,
 	                        const std::string &options)
-	: obj_(graph), options_(options), rootStyle_(rootStyle)
+	: obj_(graph), options_(options), rootStyle_(rootStyle), precision_(0),
+	  metaMin_(NAN), metaMax_(NAN), resolution_(0), rebinMode_(kEnvelope),
+	  sparseThreshold_(0.2), sparseThresholdSet_(false), budgetMergeX_(1),
+	  budgetMergeY_(1), compact_(true), nThreads_(1), budget_(0)
 {
 	if (!graph) {
 		throw std::runtime_error("ERROR: Null histogram pointer!");
@@ -27,41 +61,206 @@ void PgfPlotsPlot::AddNode(const std::string nodeLabel,
 	nodes_.push_back(std::make_pair(nodeLabel, nodeOptions));
 }
 
+/** Specify the size of the rendered figure. Graphs with many more points than
+ * pixel columns are decimated keeping the first, last, minimum and maximum
+ * point in each column, see PgfPlotsReduction::MinMaxDecimate. Histograms
+ * with many more bins than pixel columns are reduced according to the rebin
+ * mode, see SetRebinMode.
+ *
+ * \param[in] width The width of the figure in cm, zero disables the reduction.
+ * \param[in] dpi The resolution in dots per inch.
+ */
+void PgfPlotsPlot::SetResolution(const double &width, const double &dpi) {
+	resolution_ = PgfPlotsReduction::PixelColumns(width, dpi);
+}
+
+/** Select how fine binned histograms are reduced to the figure resolution.
+ *    * kEnvelope  - Keep the minimum and maximum bin in each pixel column,
+ *                   drawn unchanged. Error bar styles are not reduced.
+ *    * kMergeBins - Sum groups of bins if the number of bins is divisible
+ *                   by a factor close to the number of bins per column,
+ *                   otherwise the envelope is used.
+ *
+ * \param[in] rebinMode The reduction used for histograms.
+ */
+void PgfPlotsPlot::SetRebinMode(const RebinMode &rebinMode) {
+	rebinMode_ = rebinMode;
+}
+
 const TH1* PgfPlotsPlot::GetHist1d() {
 	if (GetHist2d()) return nullptr;
 	return dynamic_cast<const TH1*>(obj_);
 }
 
-/**
+/**Histograms with uniform bins only write the content, and error, of each
+ * bin as a table row, pgfplots computes the x value from the row index. This
+ * is used whenever it is shorter than the coordinates of the changed bins,
+ * see SetCompact.
+ *
  * \param[in] hist Pointer to the histogram to be plotted.
  * \param[in] rootStyle The options to use when plotting the histogram. Currently
  *  supported:
  *    * ""   - Same as HIST below.
- *    * HIST - Draw just the histogram.
+ *    * HIST - Draw just the histogram. Consecutive bins with equal content
+ *             are written as a single step.
  * 	* E    - Draw error bars, show only the bars no markers or lines.
  * 	* E1   - Draw error bars with small lines at end and show markers.
  * \param[in] options Options to the pgfplots plot command.
+ * \param[in] precision Significant digits of the coordinates, zero selects the
+ *  shortest representation that reproduces the values exactly.
  *
  * \return A string containing the pgfplots code to render the plot.
  */
 std::string PgfPlotsPlot::PlotTH1(const TH1 *hist,
                                   const std::string &rootStyle,
-                                  const std::string &options)
+                                  const std::string &options,
+                                  const int &precision)
 {
 	//If this is a TH2 we want to call PlotTH2
 	const TH2* h2 = dynamic_cast<const TH2*>(hist);
 	if (h2) {
-		return PlotTH2(h2, rootStyle, options);
+		return PlotTH2(h2, rootStyle, options, precision);
 	}
 
+	PgfPlotsPlot plot(hist, rootStyle);
+	std::stringbuf output;
+	{
+		TikzWriter writer(&output, precision);
+		plot.WriteTH1(writer, hist, options);
+	}
+	return output.str();
+}
+
+/**
+ * \param[in] graph Pointer to the graph to be plotted.
+ * \param[in] rootStyle The options to use when plotting the graph. Currently
+ *  supported:
+ *    * "" - Default option is "PL".
+ *    * P  - Draw points.
+ *    * L  - Draw a connecting line.
+ * \param[in] options Options to the pgfplots plot command.
+ * \param[in] precision Significant digits of the coordinates, zero selects the
+ *  shortest representation that reproduces the values exactly.
+ *
+ * \return A string containing the pgfplots code to render the plot.
+ */
+std::string PgfPlotsPlot::PlotTGraph(const TGraph *graph,
+                                     const std::string &rootStyle,
+                                     const std::string &options,
+                                     const int &precision)
+{
+	PgfPlotsPlot plot(graph, rootStyle);
+	std::stringbuf output;
+	{
+		TikzWriter writer(&output, precision);
+		plot.WriteTGraph(writer, graph, options);
+	}
+	return output.str();
+}
+
+/**By default creates a TikZ matrix plot which is typically used to plot values
+ * in a matrix, but can be easily adapted to a two-dimensional histogram. A
+ * matrix plot requires that all bins are defined, and thus the option
+ * "restrict z to domain*" is used so that empty bins are set to the minimum
+ * value. If the option "SURF" is provided a surface plot is created instead,
+ * this type of plot requires data at the corners to be provided and thus plots
+ * one less bin than is contained in the input histogram. Matrix plots of
+ * histograms with less than 20% of the bins filled only write the filled bins
+ * as rectangular patches, see SetSparseThreshold. On a uniform grid only the
+ * bin contents are written and the x and y values are computed by pgfplots.
+ *
+ * \param[in] hist Pointer to the histogram to be plotted.
+ * \param[in] rootStyle The options to use when plotting the histogram.
+ * \param[in] options Options to the pgfplots plot command.
+ * \param[in] precision Significant digits of the coordinates, zero selects the
+ *  shortest representation that reproduces the values exactly.
+ */
+std::string PgfPlotsPlot::PlotTH2(const TH2 *hist,
+                                  const std::string &rootStyle,
+                                  const std::string &options,
+                                  const int &precision)
+{
+	PgfPlotsPlot plot(hist, rootStyle);
+	std::stringbuf output;
+	{
+		TikzWriter writer(&output, precision);
+		plot.WriteTH2(writer, hist, options);
+	}
+	return output.str();
+}
+
+/** Stream the addplot command for a one-dimensional histogram, see PlotTH1
+ * for the supported styles.
+ *
+ * \param[in] output The writer receiving the plot.
+ * \param[in] hist Pointer to the histogram to be plotted.
+ * \param[in] options Options to the pgfplots plot command.
+ */
+void PgfPlotsPlot::WriteTH1(TikzWriter &output, const TH1 *hist,
+                            const std::string &options)
+{
 	bool includeErrors = false; //Include errors, shows only the error bars, no markers. ROOT option E.
 	bool errorMarks = false; //Small lines are darwn at end of the error bars and markers are shown. ROOT option E1.
 	bool histPlot = true; //Connect the point with a line
-	if (rootStyle.find("E") != std::string::npos) includeErrors = true;
-	if (rootStyle.find("E1") != std::string::npos) errorMarks = true;
-	if (rootStyle != "" && rootStyle.find("HIST") == std::string::npos) histPlot = false;
+	if (rootStyle_.find("E") != std::string::npos) includeErrors = true;
+	if (rootStyle_.find("E1") != std::string::npos) errorMarks = true;
+	if (rootStyle_ != "" && rootStyle_.find("HIST") == std::string::npos) histPlot = false;
 
-	std::stringstream output;
+	//Reduce the number of steps if the bins are much finer than the figure
+	//resolution, either by merging bins or by keeping the extreme bins.
+	const int nBins = hist->GetNbinsX();
+	int mergeFactor = 1;
+	std::vector< int > envelopeBins;
+	if (resolution_ && nBins > 2 * static_cast<int>(resolution_)) {
+		if (rebinMode_ == kMergeBins) {
+			mergeFactor = std::max(PgfPlotsReduction::MergeFactor(nBins, resolution_), 1);
+		}
+		if (mergeFactor == 1 && !includeErrors) {
+			envelopeBins = PgfPlotsReduction::EnvelopeBins(hist, resolution_);
+		}
+	}
+	const int nSteps = envelopeBins.empty() ? nBins / mergeFactor : envelopeBins.size();
+
+	//Each step starts at a bin and spans the merged bins.
+	auto FirstBin = [&](const int &step) {
+		return envelopeBins.empty() ? step * mergeFactor + 1 : envelopeBins[step];
+	};
+	auto Content = [&](const int &step) {
+		const int first = FirstBin(step);
+		double content = hist->GetBinContent(first);
+		for (int bin = first + 1; bin < first + mergeFactor; bin++) {
+			content += hist->GetBinContent(bin);
+		}
+		return content;
+	};
+	//A const plot only needs a coordinate where the content changes, so runs
+	//of equal content are collapsed into their first bin. Other line styles
+	//interpolate between the points and keep every bin. With error bars only
+	//the bins containing zero counts are suppressed.
+	auto Changed = [&](const double &content, const double &previousContent) {
+		if (includeErrors) return errorMarks || content != 0 || previousContent != 0;
+		return !histPlot || content != previousContent;
+	};
+
+	//Steps of equal width are written as a row of content and error, with
+	//the x value computed from the row index, if this is cheaper than the
+	//coordinates of the changed steps.
+	const double lowEdge = hist->GetBinLowEdge(1);
+	const double stepWidth = hist->GetBinWidth(1) * mergeFactor;
+	const size_t compactRows = nSteps + (includeErrors ? 0 : 3);
+	bool compact = compact_ && envelopeBins.empty()
+		&& IsUniform(hist->GetXaxis()) && (!budget_ || compactRows <= budget_);
+	if (compact && !errorMarks) {
+		size_t explicitCoordinates = includeErrors ? 0 : 1;
+		double previousContent = 0;
+		for (int step = 0; step < nSteps; step++) {
+			const double content = Content(step);
+			if (Changed(content, previousContent)) explicitCoordinates++;
+			previousContent = content;
+		}
+		if (!includeErrors && previousContent != 0) explicitCoordinates += 2;
+		compact = compactRows <= 2 * explicitCoordinates;
+	}
 
 	//Setup the plot style
 	output << "\t\\addplot+[";
@@ -73,8 +272,10 @@ std::string PgfPlotsPlot::PlotTH1(const TH1 *hist,
 		if (!errorMarks) output << "scatter, mark=none, ";
 		//Remove the line connecting the points.
 		if (!histPlot) output << "only marks, ";
-		//Setup the error bars.
-		output << "error bars/.cd, y dir=both, y explicit, x dir=both, x explicit";
+		//Setup the error bars, the x errors of equal steps are all the same.
+		output << "error bars/.cd, y dir=both, y explicit, x dir=both, ";
+		if (compact) output << "x fixed=" << stepWidth / 2;
+		else output << "x explicit";
 		//Remove the edges (marks) at the end of the error bars.
 		if (!errorMarks) output << ", error mark = none";
 	}
@@ -85,63 +286,123 @@ std::string PgfPlotsPlot::PlotTH1(const TH1 *hist,
 	output << "\t]\n";
 
 	//Begin the cooridnate list
-	output << "\t\tcoordinates { ";
+	std::string tableOptions;
+	if (compact && includeErrors) {
+		tableOptions = "header=false, x expr={\\lineno*"
+			+ std::string(TikzNumber(stepWidth).c_str()) + "+"
+			+ TikzNumber(lowEdge + stepWidth / 2).c_str()
+			+ "}, y index=0, y error index=1";
+	}
+	else if (compact) {
+		//The first and last two rows are the edges of the outer steps.
+		tableOptions = "header=false, x expr={min(max(\\lineno-1,0),"
+			+ std::to_string(nSteps) + ")*" + TikzNumber(stepWidth).c_str() + "+"
+			+ TikzNumber(lowEdge).c_str() + "}, y index=0";
+	}
+	else if (includeErrors) tableOptions = "x error index=2, y error index=3";
+	std::filebuf tableBuf;
+	std::unique_ptr< TikzWriter > table = BeginTable(output, tableBuf, tableOptions);
+	if (!table && compact) output << "\t\ttable[" << tableOptions << "] {\n";
+	else if (!table) output << "\t\tcoordinates { ";
+	TikzWriter &data = table ? *table : output;
 
 	//Add an initial coordinate to extend the left edge of the first bin to zero.
-	if (!includeErrors) output << "(" << hist->GetBinLowEdge(1) << ",0) ";
-
-	//Loop over every bin and add a corrdinate for it
-	for (int xbin=1; xbin <= hist->GetNbinsX(); xbin++) {
-		//Suppress the bins containing zero counts to speed up LaTeX rendering.
-		if (errorMarks || (hist->GetBinContent(xbin) != 0 || hist->GetBinContent(xbin - 1) != 0)) {
-			output << "(";
-			if (includeErrors) output << hist->GetBinCenter(xbin);
-			else output << hist->GetBinLowEdge(xbin);
-			output << "," << hist->GetBinContent(xbin) << ") ";
-			if (includeErrors) output << " +- (" << hist->GetBinWidth(xbin) / 2 <<
-				"," << hist->GetBinError(xbin) << ") ";
-		}
+	if (!includeErrors) {
+		if (compact) WriteRow(data, 0);
+		else WriteCoordinate(data, lowEdge, 0);
 	}
 
+	//Loop over the steps and add a corrdinate for them. Whether a step is
+	//written depends only on the step before it.
+	auto WriteSteps = [&](TikzWriter &stepData, const size_t &first,
+	                      const size_t &last) {
+		double previousContent = first ? Content(first - 1) : 0;
+		for (int step = first; step < static_cast<int>(last); step++) {
+			const int xbin = FirstBin(step);
+			const double content = Content(step);
+			const bool changed = Changed(content, previousContent);
+			previousContent = content;
+
+			if (!includeErrors && (changed || compact)) {
+				if (compact) WriteRow(stepData, content);
+				else WriteCoordinate(stepData, hist->GetBinLowEdge(xbin), content);
+				continue;
+			}
+			//Suppressed compact rows are discarded by pgfplots as not a number.
+			if (!changed) {
+				if (compact) WriteRow(stepData, NAN, 0);
+				continue;
+			}
+
+			double error = hist->GetBinError(xbin);
+			if (mergeFactor > 1) {
+				double sumError2 = 0;
+				for (int bin = xbin; bin < xbin + mergeFactor; bin++) {
+					sumError2 += hist->GetBinError(bin) * hist->GetBinError(bin);
+				}
+				error = std::sqrt(sumError2);
+			}
+			if (compact) WriteRow(stepData, content, error);
+			else if (mergeFactor > 1) {
+				const double stepEdge = hist->GetBinLowEdge(xbin);
+				const double width = hist->GetBinLowEdge(xbin + mergeFactor) - stepEdge;
+				WriteErrorCoordinate(stepData, stepEdge + width / 2, content,
+					width / 2, error);
+			}
+			else {
+				WriteErrorCoordinate(stepData, hist->GetBinCenter(xbin), content,
+					hist->GetBinWidth(xbin) / 2, error);
+			}
+		}
+	};
+	const size_t firstStep = data.GetCoordinates();
+	WriteChunked(data, nSteps, 1, WriteSteps);
+	const size_t writtenBins = (data.GetCoordinates() - firstStep) * mergeFactor;
+
 	//Add a final coordinate to extend the right edge of the last bin to zero.
-	if (!includeErrors && hist->GetBinContent(hist->GetNbinsX()) != 0) {
-		output << "(" << hist->GetBinLowEdge(hist->GetNbinsX()) +
-			hist->GetBinWidth(hist->GetNbinsX()) << "," << hist->GetBinContent(hist->GetNbinsX()) << ") ";
-		output << "(" << hist->GetBinLowEdge(hist->GetNbinsX()) +
-			hist->GetBinWidth(hist->GetNbinsX()) << "," << 0 << ") ";
+	const double previousContent = nSteps ? Content(nSteps - 1) : 0;
+	if (!includeErrors && previousContent != 0) {
+		double rightEdge = hist->GetBinLowEdge(nBins) + hist->GetBinWidth(nBins);
+		if (compact) {
+			WriteRow(data, previousContent);
+			WriteRow(data, 0);
+		}
+		else {
+			WriteCoordinate(data, rightEdge, previousContent);
+			WriteCoordinate(data, rightEdge, 0);
+		}
 	}
+	Strategy strategy = kFull;
+	if (mergeFactor > 1 || !envelopeBins.empty()) strategy = kRebinned;
+	else if (compact) strategy = kCompact;
+	else if (!includeErrors && writtenBins < size_t(nBins)) strategy = kRunMerged;
+	ReportData(data, table != nullptr, nBins,
+		nBins - std::min(writtenBins, size_t(nBins)), strategy);
 
 	//Coordinate list trailer.
-	output << "};\n\n";
-
-	return output.str();
+	if (!table) output << (compact ? "\t\t}" : "}");
+	WriteNodes(output);
+	output << ";\n\n";
 }
 
-/**
+/** Stream the addplot command for a graph, see PlotTGraph for the supported
+ * styles.
+ *
+ * \param[in] output The writer receiving the plot.
  * \param[in] graph Pointer to the graph to be plotted.
- * \param[in] rootStyle The options to use when plotting the graph. Currently
- *  supported:
- *    * "" - Default option is "PL".
- *    * P  - Draw points.
- *    * L  - Draw a connecting line.
  * \param[in] options Options to the pgfplots plot command.
- *
- * \return A string containing the pgfplots code to render the plot.
  */
-std::string PgfPlotsPlot::PlotTGraph(const TGraph *graph,
-                                     const std::string &rootStyle,
-                                     const std::string &options)
+void PgfPlotsPlot::WriteTGraph(TikzWriter &output, const TGraph *graph,
+                               const std::string &options)
 {
-	std::stringstream output;
-
 	bool marks = false;
 	bool lines = false;
-	if (rootStyle == "") {
+	if (rootStyle_ == "") {
 		marks = true;
 		lines = true;
 	}
-	if (rootStyle.find("P") != std::string::npos) marks = true;
-	if (rootStyle.find("L") != std::string::npos) lines = true;
+	if (rootStyle_.find("P") != std::string::npos) marks = true;
+	if (rootStyle_.find("L") != std::string::npos) lines = true;
 
 	//Setup the plot style
 	output << "\t\\addplot+[\n";
@@ -152,41 +413,69 @@ std::string PgfPlotsPlot::PlotTGraph(const TGraph *graph,
 	output << "\t]\n";
 
 	//Begin the cooridnate list
-	output << "\t\tcoordinates { ";
+	std::filebuf tableBuf;
+	std::unique_ptr< TikzWriter > table = BeginTable(output, tableBuf);
+	if (!table) output << "\t\tcoordinates { ";
+	TikzWriter &data = table ? *table : output;
 
-	for (int point = 0; point < graph->GetN(); point++) {
-		output << "(" << graph->GetX()[point] << ","
-			<< graph->GetY()[point] << ") ";
+	const double *x = graph->GetX();
+	const double *y = graph->GetY();
+	size_t suppressed = 0;
+	//Decimate only if this substantially reduces the number of points.
+	if (resolution_ && graph->GetN() > 4 * static_cast<int>(resolution_)) {
+		const std::vector< int > points =
+			PgfPlotsReduction::MinMaxDecimate(graph->GetN(), x, y, resolution_);
+		suppressed = graph->GetN() - points.size();
+		WriteChunked(data, points.size(), 1,
+			[&](TikzWriter &pointData, const size_t &first, const size_t &last) {
+				for (size_t index = first; index < last; index++) {
+					WriteCoordinate(pointData, x[points[index]], y[points[index]]);
+				}
+			});
+	}
+	else {
+		WriteChunked(data, graph->GetN(), 1,
+			[&](TikzWriter &pointData, const size_t &first, const size_t &last) {
+				for (size_t point = first; point < last; point++) {
+					WriteCoordinate(pointData, x[point], y[point]);
+				}
+			});
 	}
+	ReportData(data, table != nullptr, graph->GetN(), suppressed,
+		suppressed ? kDecimated : kFull);
 
 	//Coordinate list trailer.
-	output << "};\n\n";
-
-	return output.str();
+	if (!table) output << '}';
+	WriteNodes(output);
+	output << ";\n\n";
 }
 
-/**By default creates a TikZ matrix plot which is typically used to plot values
- * in a matrix, but can be easily adapted to a two-dimensional histogram. A
- * matrix plot requires that all bins are defined, and thus the option
- * "restrict z to domain*" is used so that empty bins are set to the minimum
- * value. If the option "SURF" is provided a surface plot is created instead,
- * this type of plot requires data at the corners to be provided and thus plots
- * one less bin than is contained in the input histogram.
+/** Stream the addplot command for a two-dimensional histogram, see PlotTH2
+ * for the supported styles.
  *
+ * \param[in] output The writer receiving the plot.
  * \param[in] hist Pointer to the histogram to be plotted.
- * \param[in] rootStyle The options to use when plotting the histogram.
  * \param[in] options Options to the pgfplots plot command.
  */
-std::string PgfPlotsPlot::PlotTH2(const TH2 *hist,
-                                  const std::string &rootStyle,
-                                  const std::string &options)
+void PgfPlotsPlot::WriteTH2(TikzWriter &output, const TH2 *hist,
+                            const std::string &options)
 {
+	if (imageName_ != "") {
+		WriteImage(output, hist, options);
+		return;
+	}
+
 	bool surfPlot = false;
-	if (rootStyle.find("SURF") != std::string::npos) {
+	if (rootStyle_.find("SURF") != std::string::npos) {
 		surfPlot = true;
 	}
 
-	std::stringstream output;
+	//A patch costs four coordinates, so mostly empty histograms are cheaper
+	//written bin by bin than as a full matrix.
+	if (!surfPlot && PgfPlotsReduction::Occupancy(hist) < sparseThreshold_) {
+		WriteSparse(output, hist, options);
+		return;
+	}
 
 	output <<
 		"\t\\addplot3[";
@@ -200,44 +489,589 @@ std::string PgfPlotsPlot::PlotTH2(const TH2 *hist,
 			"mesh/rows=" << hist->GetNbinsY() << ", "
 			"mesh/ordering=rowwise,";
 	output << options;
-	output << "\t]\n"
-		"\t\tcoordinates {\n";
-
-	for (int ybin=1; ybin<= hist->GetNbinsY(); ybin++) {
-		output << "\t\t\t";
-		double yvalue;
-		if (surfPlot) yvalue = hist->GetYaxis()->GetBinLowEdge(ybin);
-		else yvalue = hist->GetYaxis()->GetBinCenter(ybin);
-		for (int xbin=1; xbin<= hist->GetNbinsX(); xbin++) {
-			double xvalue;
-			if (surfPlot) xvalue = hist->GetXaxis()->GetBinLowEdge(xbin);
-			else xvalue = hist->GetXaxis()->GetBinCenter(xbin);
-			double weight = hist->GetBinContent(xbin, ybin);
-			output << "(" << xvalue << "," << yvalue << "," << weight << ") ";
-		}
-		output << "\n";
+	output << "\t]\n";
+
+	//On a uniform grid only the contents are written, the x and y values are
+	//computed from the row index and the known number of columns.
+	const TAxis *xAxis = hist->GetXaxis();
+	const TAxis *yAxis = hist->GetYaxis();
+	const bool compact = compact_ && IsUniform(xAxis) && IsUniform(yAxis);
+	std::string tableOptions;
+	if (compact) {
+		auto Origin = [&](const TAxis *axis) {
+			return surfPlot ? axis->GetBinLowEdge(1) : axis->GetBinCenter(1);
+		};
+		const std::string columns = std::to_string(hist->GetNbinsX());
+		tableOptions = "header=false, x expr={mod(\\lineno," + columns + ")*"
+			+ TikzNumber(xAxis->GetBinWidth(1)).c_str() + "+"
+			+ TikzNumber(Origin(xAxis)).c_str() + "}, y expr={floor(\\lineno/"
+			+ columns + ")*" + TikzNumber(yAxis->GetBinWidth(1)).c_str() + "+"
+			+ TikzNumber(Origin(yAxis)).c_str() + "}, z index=0";
 	}
+	std::filebuf tableBuf;
+	std::unique_ptr< TikzWriter > table = BeginTable(output, tableBuf, tableOptions);
+	if (!table && compact) output << "\t\ttable[" << tableOptions << "] {\n";
+	else if (!table) output << "\t\tcoordinates {\n";
+	TikzWriter &data = table ? *table : output;
+
+	//Rows are separated by a new line, which leaves a blank line in tables.
+	auto WriteRows = [&](TikzWriter &rowData, const size_t &first,
+	                     const size_t &last) {
+		if (compact) {
+			for (int ybin = first + 1; ybin <= static_cast<int>(last); ybin++) {
+				for (int xbin=1; xbin<= hist->GetNbinsX(); xbin++) {
+					WriteRow(rowData, hist->GetBinContent(xbin, ybin));
+				}
+			}
+			return;
+		}
+		for (int ybin = first + 1; ybin <= static_cast<int>(last); ybin++) {
+			if (!table) rowData << "\t\t\t";
+			double yvalue;
+			if (surfPlot) yvalue = yAxis->GetBinLowEdge(ybin);
+			else yvalue = yAxis->GetBinCenter(ybin);
+			for (int xbin=1; xbin<= hist->GetNbinsX(); xbin++) {
+				double xvalue;
+				if (surfPlot) xvalue = xAxis->GetBinLowEdge(xbin);
+				else xvalue = xAxis->GetBinCenter(xbin);
+				double weight = hist->GetBinContent(xbin, ybin);
+				WriteCoordinate(rowData, xvalue, yvalue, weight);
+			}
+			rowData << '\n';
+		}
+	};
+	WriteChunked(data, hist->GetNbinsY(), hist->GetNbinsX(), WriteRows);
+	ReportData(data, table != nullptr, hist->GetNbinsX() * hist->GetNbinsY(), 0,
+		compact ? kCompact : kFull);
 
 	//Coordinate list trailer.
-	output << "\t\t};\n";
+	if (!table) output << "\t\t}";
+	WriteNodes(output);
+	output << ";\n";
+}
 
-	return output.str();
+/** A matrix plot cannot contain holes, so every empty bin of a histogram is
+ * written. If few bins are filled each filled bin is instead written as a
+ * rectangular patch spanning the bin, colored by its content.
+ *
+ * \param[in] output The writer receiving the plot.
+ * \param[in] hist Pointer to the histogram to be plotted.
+ * \param[in] options Options to the pgfplots plot command.
+ */
+void PgfPlotsPlot::WriteSparse(TikzWriter &output, const TH2 *hist,
+                               const std::string &options)
+{
+	output << "\t\\addplot3[patch, patch type=rectangle, \%Only the filled bins.\n"
+		"\t\tshader = flat corner, \n"
+		"\t\tpoint meta=z,\n";
+	output << options;
+	output << "\t]\n";
+	std::filebuf tableBuf;
+	std::unique_ptr< TikzWriter > table = BeginTable(output, tableBuf);
+	if (!table) output << "\t\tcoordinates {\n";
+	TikzWriter &data = table ? *table : output;
+
+	const TAxis *xAxis = hist->GetXaxis();
+	const TAxis *yAxis = hist->GetYaxis();
+	auto WriteRows = [&](TikzWriter &rowData, const size_t &first,
+	                     const size_t &last) {
+		for (int ybin = first + 1; ybin <= static_cast<int>(last); ybin++) {
+			const double yLow = yAxis->GetBinLowEdge(ybin);
+			const double yHigh = yAxis->GetBinUpEdge(ybin);
+			for (int xbin=1; xbin<= hist->GetNbinsX(); xbin++) {
+				double weight = hist->GetBinContent(xbin, ybin);
+				if (weight == 0) continue;
+				const double xLow = xAxis->GetBinLowEdge(xbin);
+				const double xHigh = xAxis->GetBinUpEdge(xbin);
+				if (!table) rowData << "\t\t\t";
+				WriteCoordinate(rowData, xLow, yLow, weight);
+				WriteCoordinate(rowData, xHigh, yLow, weight);
+				WriteCoordinate(rowData, xHigh, yHigh, weight);
+				WriteCoordinate(rowData, xLow, yHigh, weight);
+				if (!table) rowData << '\n';
+			}
+		}
+	};
+	//Only the filled bins are written, so the rows are sized by occupancy.
+	const size_t rowCoordinates = 4 * hist->GetNbinsX() *
+		std::max(PgfPlotsReduction::Occupancy(hist), 0.01);
+	WriteChunked(data, hist->GetNbinsY(), rowCoordinates, WriteRows);
+	const size_t nBins = hist->GetNbinsX() * hist->GetNbinsY();
+	ReportData(data, table != nullptr, nBins, nBins - data.GetCoordinates() / 4,
+		kSparse);
+
+	//Coordinate list trailer.
+	if (!table) output << "\t\t}";
+	WriteNodes(output);
+	output << ";\n";
+}
+
+/** TikZ is capable of using a previously rendered image and placing it within
+ * axes that are rendered by TikZ. The histogram is rendered with one pixel
+ * per bin through the default colormap and placed with `\addplot graphics`.
+ * Nodes are not supported by the graphics command and are ignored.
+ *
+ * \param[in] output The writer receiving the plot.
+ * \param[in] hist Pointer to the histogram to be plotted.
+ * \param[in] options Options to the pgfplots plot command.
+ */
+void PgfPlotsPlot::WriteImage(TikzWriter &output, const TH2 *hist,
+                              const std::string &options)
+{
+	//The colors follow the point meta range of the axis, which the color bar
+	//and the other plots of the axis share.
+	double zMin = metaMin_, zMax = metaMax_;
+	if (!std::isfinite(zMin) || !std::isfinite(zMax)) {
+		hist->GetMinimumAndMaximum(zMin, zMax);
+	}
+	TikzImage::FromTH2(hist, zMin, zMax).WritePng(imageName_);
+	ReportData(output, false, hist->GetNbinsX() * hist->GetNbinsY(), 0, kImage);
+
+	if (!nodes_.empty()) {
+		std::cerr << "WARNING: Nodes are not supported for rendered images and are ignored.\n";
+	}
+
+	const TAxis *xAxis = hist->GetXaxis();
+	const TAxis *yAxis = hist->GetYaxis();
+	output << "\t\\addplot[\n";
+	output << options;
+	output << "\t] graphics[xmin=" << xAxis->GetXmin() << ", xmax=" << xAxis->GetXmax()
+		<< ", ymin=" << yAxis->GetXmin() << ", ymax=" << yAxis->GetXmax()
+		<< "] {" << imageName_ << "};\n\n";
+}
+
+/** If a table file has been specified the data file is opened and the table
+ * command referencing it is written to the output. The returned writer must
+ * be destroyed before the file buffer.
+ *
+ * \param[in] output The writer receiving the plot command.
+ * \param[in] tableBuf The file buffer to be opened for the table.
+ * \param[in] tableOptions Options to the pgfplots table command.
+ * \return A writer for the table file or null if the data is inline.
+ */
+std::unique_ptr< TikzWriter > PgfPlotsPlot::BeginTable(TikzWriter &output,
+	std::filebuf &tableBuf, const std::string &tableOptions /* = "" */)
+{
+	std::unique_ptr< TikzWriter > table;
+	if (tableFile_.empty()) return table;
+
+	if (!tableBuf.open(tableFile_, std::ios::out | std::ios::trunc)) {
+		throw std::runtime_error("ERROR: Unable to open table file '" + tableFile_ + "'!");
+	}
+	table.reset(new TikzWriter(&tableBuf, precision_));
+
+	output << "\t\ttable";
+	if (tableOptions != "") output << '[' << tableOptions << ']';
+	output << " {" << tableFile_ << '}';
+	return table;
+}
+
+/** Write a sequence of items, e.g. points or histogram rows, whose output
+ * depends only on the item index. With more than one thread the items are
+ * split into chunks of about kChunkCoordinates coordinates, which are
+ * formatted concurrently into separate buffers and written out in order.
+ * The output is therefore the same for any number of threads. Chunks are
+ * processed in groups of two per thread to bound the buffered memory.
+ *
+ * \param[in] data The writer receiving the coordinate data.
+ * \param[in] nItems The number of items.
+ * \param[in] itemCoordinates The approximate number of coordinates per item.
+ * \param[in] writeItems Writes the items in the range [first, last).
+ */
+void PgfPlotsPlot::WriteChunked(TikzWriter &data, const size_t &nItems,
+	const size_t &itemCoordinates, const ItemWriter &writeItems)
+{
+	const unsigned int nThreads = TikzParallel::GetThreads(nThreads_);
+	const size_t chunkItems =
+		std::max(kChunkCoordinates / std::max(itemCoordinates, size_t(1)), size_t(1));
+	if (nThreads == 1 || nItems <= chunkItems) {
+		writeItems(data, 0, nItems);
+		return;
+	}
+
+	const size_t nChunks = (nItems + chunkItems - 1) / chunkItems;
+	const size_t groupSize = 2 * nThreads;
+	std::vector< std::string > outputs;
+	std::vector< size_t > coordinates;
+	for (size_t firstChunk = 0; firstChunk < nChunks; firstChunk += groupSize) {
+		const size_t nGroupChunks = std::min(groupSize, nChunks - firstChunk);
+		outputs.assign(nGroupChunks, "");
+		coordinates.assign(nGroupChunks, 0);
+		TikzParallel::For(nGroupChunks, nThreads, [&](const size_t &index) {
+			const size_t first = (firstChunk + index) * chunkItems;
+			std::stringbuf chunkBuf;
+			{
+				TikzWriter chunk(&chunkBuf, precision_);
+				writeItems(chunk, first, std::min(first + chunkItems, nItems));
+				coordinates[index] = chunk.GetCoordinates();
+			}
+			outputs[index] = chunkBuf.str();
+		});
+		for (size_t index = 0; index < nGroupChunks; index++) {
+			data.Write(outputs[index].data(), outputs[index].size());
+			data.AddCoordinates(coordinates[index]);
+		}
+	}
 }
+
+/** The coordinates are counted by the writer receiving the data, which is
+ * the table writer if the data is written to an external table.
+ *
+ * \param[in] data The writer which received the coordinate data.
+ * \param[in] table Flag indicating the data was written to a table.
+ * \param[in] items The number of bins or points of the plotted object.
+ * \param[in] suppressed The bins or points not written as a coordinate.
+ * \param[in] strategy The representation of the data.
+ */
+void PgfPlotsPlot::ReportData(const TikzWriter &data, const bool &table,
+                              const size_t &items, const size_t &suppressed,
+                              const Strategy &strategy)
+{
+	report_.strategy = GetStrategyName(strategy);
+	report_.items = items;
+	report_.suppressed = suppressed;
+	report_.coordinates = data.GetCoordinates();
+	if (table) report_.tableBytes = data.GetBytes();
+}
+
+/** Write a coordinate either inline or as a table row.
+ *
+ * \param[in] data The writer receiving the coordinate data.
+ */
+void PgfPlotsPlot::WriteCoordinate(TikzWriter &data, const double &x,
+                                   const double &y)
+{
+	data.AddCoordinates();
+	if (!tableFile_.empty()) data << x << ' ' << y << '\n';
+	else data << '(' << x << ',' << y << ") ";
+}
+
+void PgfPlotsPlot::WriteCoordinate(TikzWriter &data, const double &x,
+                                   const double &y, const double &z)
+{
+	data.AddCoordinates();
+	if (!tableFile_.empty()) data << x << ' ' << y << ' ' << z << '\n';
+	else data << '(' << x << ',' << y << ',' << z << ") ";
+}
+
+/** Write a row of a compact table, whose x and y values are computed by
+ * pgfplots from the row index. The rows are the same inline and in a table
+ * file.
+ *
+ * \param[in] data The writer receiving the coordinate data.
+ */
+void PgfPlotsPlot::WriteRow(TikzWriter &data, const double &value) {
+	data.AddCoordinates();
+	data << value << '\n';
+}
+
+void PgfPlotsPlot::WriteRow(TikzWriter &data, const double &value,
+                            const double &error)
+{
+	data.AddCoordinates();
+	data << value << ' ' << error << '\n';
+}
+
+void PgfPlotsPlot::WriteErrorCoordinate(TikzWriter &data, const double &x,
+                                        const double &y, const double &xError,
+                                        const double &yError)
+{
+	data.AddCoordinates();
+	if (!tableFile_.empty()) {
+		data << x << ' ' << y << ' ' << xError << ' ' << yError << '\n';
+	}
+	else {
+		data << '(' << x << ',' << y << ")  +- (" << xError << ',' << yError << ") ";
+	}
+}
+
+/** Write the registered nodes, these follow the coordinate list.
+ *
+ * \param[in] output The writer receiving the nodes.
+ */
+void PgfPlotsPlot::WriteNodes(TikzWriter &output) {
+	for (auto &nodeInfo : nodes_) {
+		output << "\n\t\t" << NodeString(nodeInfo.first, nodeInfo.second);
+	}
+}
+
+namespace {
+	/// Add the storage array of a histogram if it is of the given type.
+	template < typename Array >
+	bool HashArray(TikzHash &hash, const TH1 *hist) {
+		auto array = dynamic_cast<const Array*>(hist);
+		if (!array) return false;
+		hash.Add(array->GetArray(), array->GetSize() * sizeof(*array->GetArray()));
+		return true;
+	}
+}
+
+/** Add everything the output of the plot depends on to a hash. Histogram
+ * contents are taken from the storage arrays, which is much cheaper than
+ * formatting them. Profiles store sums rather than the bin contents, so their
+ * contents and errors are added bin by bin.
+ *
+ * \param[in] hash The hash receiving the plot content.
+ */
+void PgfPlotsPlot::Hash(TikzHash &hash) {
+	hash.Add(rootStyle_);
+	hash.Add(options_.GetString());
+	hash.AddValue(nodes_.size());
+	for (auto &nodeInfo : nodes_) {
+		hash.Add(nodeInfo.first);
+		hash.Add(nodeInfo.second);
+	}
+	hash.AddValue(precision_);
+	hash.Add(tableFile_);
+	hash.Add(imageName_);
+	hash.AddValue(compact_);
+	hash.AddValue(resolution_);
+	hash.AddValue(rebinMode_);
+	hash.AddValue(sparseThreshold_);
+	hash.AddValue(sparseThresholdSet_);
+	hash.AddValue(budget_);
+
+	auto graph = GetGraph();
+	if (graph) {
+		hash.AddValue(graph->GetN());
+		hash.Add(graph->GetX(), graph->GetN() * sizeof(double));
+		hash.Add(graph->GetY(), graph->GetN() * sizeof(double));
+		return;
+	}
+
+	auto hist = dynamic_cast<const TH1*>(obj_);
+	if (!hist) return;
+	hash.AddValue(hist->GetDimension());
+	for (const TAxis *axis : {hist->GetXaxis(), hist->GetYaxis()}) {
+		hash.AddValue(axis->GetNbins());
+		hash.AddValue(axis->GetXmin());
+		hash.AddValue(axis->GetXmax());
+		const TArrayD *edges = axis->GetXbins();
+		hash.Add(edges->GetArray(), edges->GetSize() * sizeof(double));
+	}
+
+	if (!dynamic_cast<const TProfile*>(hist) && (HashArray<TArrayD>(hash, hist)
+		|| HashArray<TArrayF>(hash, hist) || HashArray<TArrayI>(hash, hist)
+		|| HashArray<TArrayS>(hash, hist) || HashArray<TArrayC>(hash, hist)))
+	{
+		const TArrayD *sumw2 = hist->GetSumw2();
+		hash.Add(sumw2->GetArray(), sumw2->GetSize() * sizeof(double));
+		return;
+	}
+	for (int bin = 0; bin < hist->GetNcells(); bin++) {
+		hash.AddValue(hist->GetBinContent(bin));
+		hash.AddValue(hist->GetBinError(bin));
+	}
+}
+
+/** Estimate the number of coordinates written without any reduction, using
+ * the cheaper of the lossless representations: runs of equal content are
+ * merged in histogram plots and mostly empty TH2s are written as patches.
+ * The estimate only inspects the data and does not format it.
+ *
+ * \return The number of coordinates.
+ */
+size_t PgfPlotsPlot::GetLosslessCoordinates() {
+	if (imageName_ != "") return 0;
+
+	auto graph = GetGraph();
+	if (graph) return graph->GetN();
+
+	auto hist2d = GetHist2d();
+	if (hist2d) {
+		const size_t nBins = hist2d->GetNbinsX() * hist2d->GetNbinsY();
+		if (rootStyle_.find("SURF") != std::string::npos) return nBins;
+		const double occupancy = PgfPlotsReduction::Occupancy(hist2d);
+		const double threshold = sparseThresholdSet_ || !budget_ ?
+			sparseThreshold_ : kBudgetSparseThreshold;
+		if (occupancy >= threshold) return nBins;
+		return std::min(nBins, size_t(4 * occupancy * nBins + 0.5));
+	}
+
+	auto hist1d = GetHist1d();
+	if (!hist1d) return 0;
+	const bool includeErrors = rootStyle_.find("E") != std::string::npos;
+	const bool errorMarks = rootStyle_.find("E1") != std::string::npos;
+	const bool histPlot = rootStyle_ == "" || rootStyle_.find("HIST") != std::string::npos;
+	const int nBins = hist1d->GetNbinsX();
+	if (errorMarks) return nBins;
+
+	//Mirror the suppression of WriteTH1, with the edges of the const plot.
+	size_t coordinates = includeErrors ? 0 : 1;
+	double previousContent = 0;
+	for (int bin = 1; bin <= nBins; bin++) {
+		const double content = hist1d->GetBinContent(bin);
+		if (includeErrors ? content != 0 || previousContent != 0
+		                  : !histPlot || content != previousContent) coordinates++;
+		previousContent = content;
+	}
+	if (!includeErrors && previousContent != 0) coordinates += 2;
+	return coordinates;
+}
+
+/** Estimate the bytes written inline from the number of bins or points,
+ * limited by the budget. It is only used to size the output buffer, which
+ * grows if the estimate is too small.
+ *
+ * \return The estimated number of bytes.
+ */
+size_t PgfPlotsPlot::EstimateBytes() {
+	if (imageName_ != "" || tableFile_ != "") return kBytesPerPlot;
+
+	size_t coordinates = 0;
+	if (auto graph = GetGraph()) coordinates = graph->GetN();
+	else if (auto hist2d = GetHist2d()) {
+		coordinates = hist2d->GetNbinsX() * hist2d->GetNbinsY();
+	}
+	else if (auto hist1d = GetHist1d()) coordinates = hist1d->GetNbinsX() + 2;
+	if (budget_) coordinates = std::min(coordinates, budget_);
+
+	return kBytesPerPlot + kBytesPerCoordinate * coordinates;
+}
+
+/** Select the representation of the data fitting the coordinate budget.
+ * The cheapest lossless representation is used if it fits, otherwise
+ * histograms are rebinned and graphs are decimated to the number of columns
+ * fitting the budget. TH2s are merged by the same factor along each axis,
+ * see Write. Histograms with error bars can only be merged by an integer
+ * factor of their bins, if no factor fits the budget is exceeded and a
+ * warning is printed. A coarser resolution set by the user is kept. The
+ * resolution, rebin mode, sparse threshold and TH2 merging are overwritten
+ * for the write.
+ */
+void PgfPlotsPlot::ApplyBudget() {
+	//TH2 matrix plots use patches whenever these are cheaper, unless the
+	//user chose the threshold.
+	auto hist2d = GetHist2d();
+	if (hist2d && !sparseThresholdSet_) sparseThreshold_ = kBudgetSparseThreshold;
+
+	const size_t lossless = GetLosslessCoordinates();
+	if (lossless <= budget_) return;
+
+	if (hist2d) {
+		//Keep the aspect of the bins, a factor not dividing the bins drops the
+		//incomplete group at the upper edge.
+		const int nBinsX = hist2d->GetNbinsX();
+		const int nBinsY = hist2d->GetNbinsY();
+		const double scale = std::sqrt(double(budget_) / (double(nBinsX) * nBinsY));
+		auto Factor = [&](const int &nBins) {
+			const unsigned int columns = std::max(1., std::floor(nBins * scale));
+			const int factor = PgfPlotsReduction::MergeFactor(nBins, columns);
+			return factor ? factor : int((nBins + columns - 1) / columns);
+		};
+		budgetMergeX_ = Factor(nBinsX);
+		budgetMergeY_ = Factor(nBinsY);
+		return;
+	}
+
+	auto SetColumns = [&](const size_t &columns) {
+		const unsigned int budgetColumns = std::max< size_t >(columns, 1);
+		if (!resolution_ || resolution_ > budgetColumns) resolution_ = budgetColumns;
+	};
+	if (GetGraph()) {
+		//Each bucket keeps at most four points.
+		SetColumns(budget_ / 4);
+		return;
+	}
+	auto hist1d = GetHist1d();
+	if (hist1d && rootStyle_.find("E") == std::string::npos) {
+		//The envelope keeps at most two bins per column and the edges.
+		rebinMode_ = kEnvelope;
+		SetColumns((std::max< size_t >(budget_, 3) - 3) / 2);
+		return;
+	}
+	if (hist1d) {
+		const int nBins = hist1d->GetNbinsX();
+		rebinMode_ = kMergeBins;
+		SetColumns(budget_ / 2);
+		if (nBins > 2 * static_cast<int>(resolution_)
+			&& PgfPlotsReduction::MergeFactor(nBins, resolution_)) return;
+	}
+
+	std::cerr << "WARNING: Plot '" << obj_->GetName() << "' cannot be reduced to "
+		<< budget_ << " coordinates, " << lossless << " coordinates are written.\n";
+}
+
+/**
+ * \param[in] strategy The representation.
+ * \return The name of the representation.
+ */
+std::string PgfPlotsPlot::GetStrategyName(const Strategy &strategy) {
+	switch (strategy) {
+		case kFull: return "full";
+		case kRunMerged: return "run-merged";
+		case kRebinned: return "rebinned";
+		case kDecimated: return "decimated";
+		case kSparse: return "sparse";
+		case kImage: return "image";
+		case kCompact: return "compact";
+	}
+	return "";
+}
+
+/** Stream the plot and its nodes to the specified buffer. The cost of the
+ * write and the selected representation are recorded in the report, see
+ * GetReport. If a budget is set the representation is selected to fit it,
+ * see ApplyBudget. A TH2 over the budget is written from a rebinned clone
+ * holding the mean content of the merged bins, which keeps the contents
+ * within the point meta range of the axis.
+ *
+ * \param[in] buf The buffer that the plot should be written into.
+ */
 void PgfPlotsPlot::Write(std::streambuf *buf) {
-	std::string plot_str;
+	auto start = std::chrono::steady_clock::now();
+	report_ = TikzReport::Plot();
+	report_.name = obj_->GetName();
+	report_.type = obj_->ClassName();
+
+	//The settings overwritten by the budget are restored after the write.
+	const unsigned int resolution = resolution_;
+	const RebinMode rebinMode = rebinMode_;
+	const double sparseThreshold = sparseThreshold_;
+	if (budget_) ApplyBudget();
+
+	TikzWriter output(buf, precision_);
+
 	auto hist1d = GetHist1d();
 	auto hist2d = GetHist2d();
 	auto graph = GetGraph();
-	if (hist1d) plot_str = PlotTH1(hist1d, rootStyle_, options_.GetString());
-	else if (hist2d) plot_str = PlotTH2(hist2d, rootStyle_, options_.GetString());
-	else if (graph) plot_str = PlotTGraph(graph, rootStyle_, options_.GetString());
-	size_t loc = plot_str.find_last_of("}") + 1;
-	for (auto nodeInfo : nodes_) {
-		plot_str.insert(loc, "\n\t\t" + NodeString(nodeInfo.first, nodeInfo.second));
+	auto Restore = [&]() {
+		resolution_ = resolution;
+		rebinMode_ = rebinMode;
+		sparseThreshold_ = sparseThreshold;
+		budgetMergeX_ = 1;
+		budgetMergeY_ = 1;
+	};
+	try {
+		if (hist1d) WriteTH1(output, hist1d, options_.GetString());
+		else if (hist2d && (budgetMergeX_ > 1 || budgetMergeY_ > 1)) {
+			std::unique_ptr< TH2 > rebinned(static_cast<TH2*>(hist2d->Clone()));
+			rebinned->SetDirectory(nullptr);
+			rebinned->Rebin2D(budgetMergeX_, budgetMergeY_);
+			rebinned->Scale(1. / (budgetMergeX_ * budgetMergeY_));
+			WriteTH2(output, rebinned.get(), options_.GetString());
+
+			const size_t nBins = hist2d->GetNbinsX() * hist2d->GetNbinsY();
+			report_.strategy = GetStrategyName(kRebinned);
+			report_.items = nBins;
+			report_.suppressed = nBins - std::min(nBins,
+				size_t(rebinned->GetNbinsX() * rebinned->GetNbinsY()));
+		}
+		else if (hist2d) WriteTH2(output, hist2d, options_.GetString());
+		else if (graph) WriteTGraph(output, graph, options_.GetString());
+	}
+	catch (...) {
+		Restore();
+		throw;
 	}
+	output.Flush();
+	Restore();
 
-	std::ostream output(buf);
-	output << plot_str;
+	report_.bytes = output.GetBytes();
+	report_.seconds = std::chrono::duration< double >(
+		std::chrono::steady_clock::now() - start).count();
+	report_.texMemory = TikzReport::EstimateTexMemory(report_.coordinates,
+		report_.bytes);
 }
 
 std::string PgfPlotsPlot::NodeString(std::string nodeLabel, std::string nodeOptions) {
@@ -0,0 +1,197 @@
+#include "PgfPlotsReduction.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <TArrayC.h>
+#include <TArrayD.h>
+#include <TArrayF.h>
+#include <TArrayI.h>
+#include <TArrayS.h>
+#include <TProfile.h>
+
+/**
+ * \param[in] width The width of the figure in cm.
+ * \param[in] dpi The resolution in dots per inch.
+ * \return The number of pixel columns, zero if the width is not positive.
+ */
+unsigned int PgfPlotsReduction::PixelColumns(const double &width,
+                                             const double &dpi)
+{
+	if (width <= 0 || dpi <= 0) return 0;
+	return std::ceil(width / 2.54 * dpi);
+}
+
+/** Decimate a series by dividing the x range into buckets, typically one per
+ * pixel column, and keeping only the first, last, minimum and maximum point
+ * of each consecutive run of points falling in the same bucket. The extrema
+ * are therefore preserved exactly and the line drawn through the kept points
+ * covers the same pixels. Unsorted data is handled as the runs are formed in
+ * the original point order. Points with a non-finite x value do not count
+ * towards the range and form runs of their own, so a gap in the data is
+ * kept. The method runs in linear time.
+ *
+ * \param[in] nPoints The number of points.
+ * \param[in] x The x values.
+ * \param[in] y The y values.
+ * \param[in] buckets The number of buckets across the x range.
+ * \return The indices of the kept points in increasing order.
+ */
+std::vector< int > PgfPlotsReduction::MinMaxDecimate(const int &nPoints,
+	const double *x, const double *y, const unsigned int &buckets)
+{
+	std::vector< int > indices;
+	if (nPoints <= 0) return indices;
+	if (buckets == 0) {
+		for (int point = 0; point < nPoints; point++) indices.push_back(point);
+		return indices;
+	}
+
+	double xMin = INFINITY, xMax = -INFINITY;
+	for (int point = 0; point < nPoints; point++) {
+		if (!std::isfinite(x[point])) continue;
+		if (x[point] < xMin) xMin = x[point];
+		if (x[point] > xMax) xMax = x[point];
+	}
+	const double scale = xMax > xMin ? buckets / (xMax - xMin) : 0;
+	auto Bucket = [&](const int &point) -> unsigned int {
+		//Non-finite values are placed past the last bucket.
+		if (!std::isfinite(x[point])) return buckets;
+		double position = (x[point] - xMin) * scale;
+		//The upper edge is placed in the last bucket.
+		if (!(position < buckets)) return buckets - 1;
+		return position;
+	};
+
+	indices.reserve(std::min< size_t >(nPoints, 4 * buckets + 4));
+	int first = 0, minimum = 0, maximum = 0;
+	unsigned int currentBucket = Bucket(0);
+	for (int point = 1; point <= nPoints; point++) {
+		if (point < nPoints && Bucket(point) == currentBucket) {
+			if (y[point] < y[minimum]) minimum = point;
+			if (y[point] > y[maximum]) maximum = point;
+			continue;
+		}
+
+		//Close the run keeping its points in their original order.
+		int kept[4] = {first, minimum, maximum, point - 1};
+		std::sort(kept, kept + 4);
+		for (int i = 0; i < 4; i++) {
+			if (i == 0 || kept[i] != kept[i - 1]) indices.push_back(kept[i]);
+		}
+
+		if (point < nPoints) {
+			first = minimum = maximum = point;
+			currentBucket = Bucket(point);
+		}
+	}
+
+	return indices;
+}
+
+/** Select the bins needed to draw the envelope of a fine binned histogram as
+ * a const plot. The bins are divided into groups of consecutive bins, one per
+ * pixel column, and the bins containing the minimum and maximum of each group
+ * are kept. Each kept bin is drawn until the next kept bin, so peaks and
+ * valleys keep their exact height and position. The contents are read
+ * directly from the internal array of the histogram where possible.
+ *
+ * \param[in] hist The histogram to be reduced.
+ * \param[in] columns The number of pixel columns.
+ * \return The kept bin numbers in increasing order.
+ */
+std::vector< int > PgfPlotsReduction::EnvelopeBins(const TH1 *hist,
+                                                   const unsigned int &columns)
+{
+	const int nBins = hist->GetNbinsX();
+	const int groupSize = columns ? (nBins + columns - 1) / columns : 1;
+
+	//Use the storage array for the common histogram types. Profiles store
+	//sums rather than the bin contents.
+	struct BinContent {
+		const TH1 *hist;
+		double operator[](const int &bin) const {return hist->GetBinContent(bin);}
+	};
+	if (dynamic_cast<const TProfile*>(hist)) {
+		return EnvelopeBins(BinContent{hist}, nBins, groupSize);
+	}
+	if (auto array = dynamic_cast<const TArrayD*>(hist)) {
+		return EnvelopeBins(array->GetArray(), nBins, groupSize);
+	}
+	if (auto array = dynamic_cast<const TArrayF*>(hist)) {
+		return EnvelopeBins(array->GetArray(), nBins, groupSize);
+	}
+	if (auto array = dynamic_cast<const TArrayI*>(hist)) {
+		return EnvelopeBins(array->GetArray(), nBins, groupSize);
+	}
+	if (auto array = dynamic_cast<const TArrayS*>(hist)) {
+		return EnvelopeBins(array->GetArray(), nBins, groupSize);
+	}
+	if (auto array = dynamic_cast<const TArrayC*>(hist)) {
+		return EnvelopeBins(array->GetArray(), nBins, groupSize);
+	}
+
+	return EnvelopeBins(BinContent{hist}, nBins, groupSize);
+}
+
+/**
+ * \param[in] content The bin contents indexed by bin number.
+ * \param[in] nBins The number of bins excluding under and overflow.
+ * \param[in] groupSize The number of bins in each group.
+ * \return The kept bin numbers in increasing order.
+ */
+template < typename Content >
+std::vector< int > PgfPlotsReduction::EnvelopeBins(const Content &content,
+                                                   const int &nBins,
+                                                   const int &groupSize)
+{
+	std::vector< int > bins;
+	bins.reserve(2 * (nBins / groupSize + 1));
+	for (int first = 1; first <= nBins; first += groupSize) {
+		const int last = std::min(first + groupSize - 1, nBins);
+		int minimum = first, maximum = first;
+		for (int bin = first + 1; bin <= last; bin++) {
+			if (content[bin] < content[minimum]) minimum = bin;
+			if (content[bin] > content[maximum]) maximum = bin;
+		}
+		bins.push_back(std::min(minimum, maximum));
+		if (minimum != maximum) bins.push_back(std::max(minimum, maximum));
+	}
+	return bins;
+}
+
+/** Find the number of bins to be merged so that the result has about one bin
+ * per pixel column. Only factors dividing the number of bins are accepted so
+ * that every merged bin is exact.
+ *
+ * \param[in] nBins The number of bins.
+ * \param[in] columns The number of pixel columns.
+ * \return The merge factor or zero if no factor up to twice the ideal one
+ * 	divides the number of bins.
+ */
+int PgfPlotsReduction::MergeFactor(const int &nBins, const unsigned int &columns) {
+	if (!columns) return 0;
+	const int ideal = (nBins + columns - 1) / columns;
+	for (int factor = std::max(ideal, 2); factor <= 2 * ideal; factor++) {
+		if (nBins % factor == 0) return factor;
+	}
+	return 0;
+}
+
+/**
+ * \param[in] hist The histogram to be inspected.
+ * \return The fraction of bins, excluding under and overflow, that are filled.
+ */
+double PgfPlotsReduction::Occupancy(const TH2 *hist) {
+	const int nBinsX = hist->GetNbinsX();
+	const int nBinsY = hist->GetNbinsY();
+	if (nBinsX <= 0 || nBinsY <= 0) return 0;
+
+	size_t filled = 0;
+	for (int ybin = 1; ybin <= nBinsY; ybin++) {
+		for (int xbin = 1; xbin <= nBinsX; xbin++) {
+			if (hist->GetBinContent(xbin, ybin) != 0) filled++;
+		}
+	}
+	return static_cast<double>(filled) / nBinsX / nBinsY;
+}
@@ -0,0 +1,96 @@
+#include "TikzBatch.hpp"
+
+#include <chrono>
+#include <set>
+#include <stdexcept>
+
+#include <TROOT.h>
+
+#include "TikzParallel.hpp"
+
+TikzBatch::TikzBatch(const unsigned int &nThreads)
+	: nThreads_(nThreads)
+{
+
+}
+
+/**
+ * \param[in] picture The picture to be written.
+ * \param[in] filename The output file name.
+ */
+void TikzBatch::Add(TikzPicture *picture, const std::string &filename) {
+	if (!picture) {
+		throw std::runtime_error("ERROR: Null picture pointer!");
+	}
+	jobs_.push_back(Job{picture, filename, 0, ""});
+}
+
+/** Writing a picture modifies its axes and plots, e.g. when axis options are
+ * processed, thus the jobs must not share them. Neither may they write the
+ * same file, including the tables and images written next to the pictures.
+ */
+void TikzBatch::CheckJobs() {
+	std::set< void* > objects;
+	std::set< std::string > filenames;
+	for (auto &job : jobs_) {
+		for (auto &filename : job.picture->GetOutputFiles(job.filename)) {
+			if (!filenames.insert(filename).second) {
+				throw std::runtime_error("ERROR: File '" + filename + "' is written by multiple jobs!");
+			}
+		}
+		if (!objects.insert(job.picture).second) {
+			throw std::runtime_error("ERROR: Picture for '" + job.filename + "' is written by multiple jobs!");
+		}
+		for (auto axis : job.picture->GetAxes()) {
+			if (!objects.insert(axis).second) {
+				throw std::runtime_error("ERROR: Axis in '" + job.filename + "' is shared with another job!");
+			}
+			for (auto plot : axis->GetPlots()) {
+				if (!objects.insert(plot).second) {
+					throw std::runtime_error("ERROR: Plot in '" + job.filename + "' is shared with another job!");
+				}
+			}
+		}
+	}
+}
+
+/** Write the registered pictures on a work stealing set of threads. Errors
+ * are recorded for each job and do not stop the remaining jobs.
+ *
+ * \return The timing statistics of the batch.
+ */
+TikzBatch::Statistics TikzBatch::Write() {
+	CheckJobs();
+
+	Statistics statistics = Statistics();
+	statistics.jobs = jobs_.size();
+	statistics.threads = TikzParallel::GetThreads(nThreads_);
+	if (statistics.threads > 1) ROOT::EnableThreadSafety();
+
+	auto start = std::chrono::steady_clock::now();
+	TikzParallel::For(jobs_.size(), statistics.threads, [&](const size_t &index) {
+		Job &job = jobs_[index];
+		auto jobStart = std::chrono::steady_clock::now();
+		job.error = "";
+		try {
+			job.picture->Write(job.filename);
+		}
+		catch (std::exception &exception) {
+			job.error = exception.what();
+		}
+		catch (...) {
+			job.error = "ERROR: Unknown exception!";
+		}
+		job.seconds = std::chrono::duration< double >(
+			std::chrono::steady_clock::now() - jobStart).count();
+	});
+	statistics.wallTime = std::chrono::duration< double >(
+		std::chrono::steady_clock::now() - start).count();
+
+	for (auto &job : jobs_) {
+		if (job.error != "") statistics.failed++;
+		statistics.jobTime += job.seconds;
+		if (job.seconds > statistics.maxJobTime) statistics.maxJobTime = job.seconds;
+	}
+	return statistics;
+}
@@ -0,0 +1,97 @@
+#include "TikzDocument.hpp"
+
+#include <algorithm>
+
+#include "PgfPlotsGroupPlot.hpp"
+#include "TikzPicture.hpp"
+
+TikzDocument::TikzDocument(const size_t &blockSize)
+	: blockSize_(std::max(blockSize, size_t(1024))), used_(0)
+{
+
+}
+
+TikzDocument::~TikzDocument() {
+	Release();
+}
+
+TikzPicture* TikzDocument::NewPicture(const std::string &options,
+                                      const std::string &preamble)
+{
+	return New< TikzPicture >(options, preamble);
+}
+
+PgfPlotsAxis* TikzDocument::NewAxis(const std::string &options) {
+	return New< PgfPlotsAxis >(options);
+}
+
+/** The sub plots created by the group plot are placed in the document as
+ * well.
+ */
+PgfPlotsGroupPlot* TikzDocument::NewGroupPlot(unsigned int rows,
+                                              unsigned int columns,
+                                              const std::string &options)
+{
+	PgfPlotsGroupPlot *groupPlot = New< PgfPlotsGroupPlot >(rows, columns, options);
+	groupPlot->SetDocument(this);
+	return groupPlot;
+}
+
+PgfPlotsLegend* TikzDocument::NewLegend() {
+	return New< PgfPlotsLegend >();
+}
+
+PgfPlotsPlot* TikzDocument::NewPlot(const TH1* hist,
+                                    const std::string &rootStyle,
+                                    const std::string &options)
+{
+	return New< PgfPlotsPlot >(hist, rootStyle, options);
+}
+
+PgfPlotsPlot* TikzDocument::NewPlot(const TGraph* graph,
+                                    const std::string &rootStyle,
+                                    const std::string &options)
+{
+	return New< PgfPlotsPlot >(graph, rootStyle, options);
+}
+
+/** The objects are destroyed in the reverse order of their creation. All
+ * blocks but the first are freed, so a document reused for similar figure
+ * sets rarely reserves new memory.
+ */
+void TikzDocument::Release() {
+	for (auto object = objects_.rbegin(); object != objects_.rend(); ++object) {
+		object->destroy(object->object);
+	}
+	objects_.clear();
+	if (blocks_.size() > 1) blocks_.resize(1);
+	used_ = 0;
+}
+
+size_t TikzDocument::GetBytes() const {
+	size_t bytes = 0;
+	for (auto &block : blocks_) bytes += block.second;
+	return bytes;
+}
+
+/** Objects larger than the block size get a block of their own.
+ *
+ * \param[in] size The size of the object in bytes.
+ * \param[in] alignment The alignment of the object.
+ * \return A pointer to the memory.
+ */
+void* TikzDocument::Allocate(const size_t &size, const size_t &alignment) {
+	if (!blocks_.empty()) {
+		const size_t offset = (used_ + alignment - 1) / alignment * alignment;
+		if (offset + size <= blocks_.back().second) {
+			used_ = offset + size;
+			return blocks_.back().first.get() + offset;
+		}
+	}
+
+	//The memory of new char[] is aligned for any fundamental type.
+	const size_t blockSize = std::max(blockSize_, size);
+	blocks_.emplace_back(std::unique_ptr< char[] >(new char[blockSize]), blockSize);
+	used_ = size;
+	return blocks_.back().first.get();
+}
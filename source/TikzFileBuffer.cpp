@@ -0,0 +1,138 @@
+#include "TikzFileBuffer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+	/** Read the file creation mask, which can only be read by setting it.
+	 * It is read once during static initialization, before any threads
+	 * are started.
+	 *
+	 * \return The mode of files created with the default permissions.
+	 */
+	mode_t GetFileMode() {
+		const mode_t mask = umask(0);
+		umask(mask);
+		return 0666 & ~mask;
+	}
+
+	/// The mode of committed files, as if created by a file stream.
+	const mode_t kFileMode = GetFileMode();
+}
+
+/**
+ * \param[in] size The initial capacity in characters.
+ */
+TikzFileBuffer::TikzFileBuffer(const size_t &size) {
+	Grow(size);
+}
+
+/** The storage only grows, content already collected is kept.
+ *
+ * \param[in] size The expected size of the content in characters.
+ */
+void TikzFileBuffer::Reserve(const size_t &size) {
+	if (size > data_.size()) Grow(size);
+}
+
+/** The storage grows at least by a factor of two so that appending is
+ * amortized constant time.
+ *
+ * \param[in] size The minimum capacity in characters.
+ */
+void TikzFileBuffer::Grow(const size_t &size) {
+	const size_t length = GetSize();
+	size_t capacity = std::max< size_t >(2 * data_.size(), 4096);
+	while (capacity < size) capacity *= 2;
+	data_.resize(capacity);
+	setp(data_.data(), data_.data() + data_.size());
+	Advance(length);
+}
+
+/** Move the put pointer, which pbump only takes as an int.
+ *
+ * \param[in] length The number of characters to advance.
+ */
+void TikzFileBuffer::Advance(size_t length) {
+	while (length) {
+		const int step = std::min< size_t >(length, INT_MAX);
+		pbump(step);
+		length -= step;
+	}
+}
+
+int TikzFileBuffer::overflow(int c) {
+	if (c == traits_type::eof()) return traits_type::not_eof(c);
+	Grow(data_.size() + 1);
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+	return c;
+}
+
+std::streamsize TikzFileBuffer::xsputn(const char *data, std::streamsize length) {
+	if (epptr() - pptr() < length) Grow(GetSize() + length);
+	std::memcpy(pptr(), data, length);
+	Advance(length);
+	return length;
+}
+
+/** The content is written to a uniquely named temporary file next to the
+ * destination, retrying only if the write is interrupted or partial. The
+ * temporary file is flushed to disk and then renamed to the destination.
+ * The rename replaces the file atomically, thus the destination always
+ * holds either the previous or the complete new content, even if several
+ * writers commit the same file.
+ *
+ * \param[in] filename The destination file name.
+ */
+void TikzFileBuffer::Commit(const std::string &filename) {
+	const std::string pattern = filename + ".XXXXXX";
+	std::vector< char > name(pattern.begin(), pattern.end());
+	name.push_back('\0');
+	const int file = mkstemp(name.data());
+	if (file < 0) {
+		throw std::runtime_error("ERROR: Unable to open '" + pattern + "': "
+			+ std::strerror(errno));
+	}
+	const std::string temporary = name.data();
+
+	auto Fail = [&](const int &error) {
+		close(file);
+		std::remove(temporary.c_str());
+		throw std::runtime_error("ERROR: Unable to write '" + temporary + "': "
+			+ std::strerror(error));
+	};
+
+	//mkstemp creates the file readable only by its owner, the permissions
+	//are widened to those the user's umask gives regular files.
+	if (fchmod(file, kFileMode) != 0) Fail(errno);
+
+	const char *data = pbase();
+	size_t remaining = GetSize();
+	while (remaining) {
+		const ssize_t written = write(file, data, remaining);
+		if (written < 0 && errno == EINTR) continue;
+		if (written < 0) Fail(errno);
+		//Nothing written does not set errno.
+		if (written == 0) Fail(EIO);
+		data += written;
+		remaining -= written;
+	}
+
+	if (fsync(file) != 0) Fail(errno);
+
+	if (close(file) != 0 || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+		const std::string error = std::strerror(errno);
+		std::remove(temporary.c_str());
+		throw std::runtime_error("ERROR: Unable to write '" + filename + "': " + error);
+	}
+}
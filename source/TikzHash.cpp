@@ -0,0 +1,70 @@
+#include "TikzHash.hpp"
+
+#include <cstring>
+
+namespace {
+	/// Constants of the 64 bit MurmurHash3 finalizer.
+	const uint64_t kMultiplier = 0xff51afd7ed558ccdULL;
+	const uint64_t kFinalMultiplier = 0xc4ceb9fe1a85ec53ULL;
+}
+
+TikzHash::TikzHash() : state_(0x9e3779b97f4a7c15ULL), length_(0) {
+
+}
+
+void TikzHash::Mix(const uint64_t &word) {
+	state_ ^= word * kMultiplier;
+	state_ = (state_ << 27 | state_ >> 37) * kFinalMultiplier + 0x52dce729;
+}
+
+/** Add a block of bytes. Full words are mixed directly while the remaining
+ * bytes are padded with zeros into a last word.
+ *
+ * \param[in] data The bytes to be added.
+ * \param[in] length The number of bytes.
+ */
+void TikzHash::Add(const void *data, const size_t &length) {
+	const unsigned char *bytes = static_cast<const unsigned char*>(data);
+	size_t position = 0;
+	uint64_t word;
+	for (; position + sizeof(word) <= length; position += sizeof(word)) {
+		std::memcpy(&word, bytes + position, sizeof(word));
+		Mix(word);
+	}
+	if (position < length) {
+		word = 0;
+		std::memcpy(&word, bytes + position, length - position);
+		Mix(word);
+	}
+	length_ += length;
+}
+
+/** The length is included so that consecutive strings are separated, e.g.
+ * "ab" followed by "c" differs from "a" followed by "bc".
+ *
+ * \param[in] str The string to be added.
+ */
+void TikzHash::Add(const std::string &str) {
+	Mix(str.size());
+	Add(str.data(), str.size());
+}
+
+uint64_t TikzHash::GetValue() const {
+	uint64_t hash = state_ ^ length_;
+	hash ^= hash >> 33;
+	hash *= kMultiplier;
+	hash ^= hash >> 33;
+	hash *= kFinalMultiplier;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+std::string TikzHash::GetString() const {
+	static const char kDigits[] = "0123456789abcdef";
+	const uint64_t hash = GetValue();
+	std::string str(16, '0');
+	for (int digit = 0; digit < 16; digit++) {
+		str[digit] = kDigits[(hash >> (60 - 4 * digit)) & 0xf];
+	}
+	return str;
+}
@@ -0,0 +1,148 @@
+#include "TikzImage.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+/** Create a transparent image. The palette reproduces the default pgfplots
+ * colormap (`colormap/hot`: blue, yellow, orange, red) so that the image
+ * agrees with the color bar drawn by pgfplots.
+ */
+TikzImage::TikzImage(const unsigned int &width, const unsigned int &height)
+	: width_(width), height_(height), pixels_(width * height, 0),
+	  palette_(kPaletteSize)
+{
+	const double colormap[4][3] = {{0, 0, 255}, {255, 255, 0}, {255, 128, 0},
+	                               {255, 0, 0}};
+
+	palette_[0] = {{0, 0, 0}};
+	for (unsigned int index = 1; index < kPaletteSize; index++) {
+		double position = 3. * (index - 1) / (kPaletteSize - 2);
+		unsigned int segment = position < 3 ? position : 2;
+		double fraction = position - segment;
+		for (int channel = 0; channel < 3; channel++) {
+			double value = colormap[segment][channel] + fraction *
+				(colormap[segment + 1][channel] - colormap[segment][channel]);
+			palette_[index][channel] = std::lround(value);
+		}
+	}
+}
+
+/** Map the bin contents linearly onto the palette, contents outside of the
+ * range are clamped to its ends. Only empty bins are transparent. If the
+ * range is empty, e.g. for a flat histogram, all filled bins get the first
+ * color of the palette.
+ *
+ * \param[in] hist The histogram to be rendered.
+ * \param[in] zMin The content mapped to the start of the colormap.
+ * \param[in] zMax The content mapped to the end of the colormap.
+ * \return The rendered image.
+ */
+TikzImage TikzImage::FromTH2(const TH2 *hist, const double &zMin,
+                             const double &zMax)
+{
+	const int columns = hist->GetNbinsX();
+	const int rows = hist->GetNbinsY();
+	if (hist->GetXaxis()->GetXbins()->GetSize() || hist->GetYaxis()->GetXbins()->GetSize()) {
+		std::cerr << "WARNING: Histogram '" << hist->GetName()
+			<< "' has variable bins, the rendered image assumes uniform bins.\n";
+	}
+
+	TikzImage image(columns, rows);
+	const double scale = zMax > zMin ? (kPaletteSize - 2) / (zMax - zMin) : 0;
+	for (int ybin = 1; ybin <= rows; ybin++) {
+		for (int xbin = 1; xbin <= columns; xbin++) {
+			double content = hist->GetBinContent(xbin, ybin);
+			if (content == 0 || std::isnan(content)) continue;
+			double level = (content - zMin) * scale;
+			if (!(level > 0)) level = 0;
+			if (level > kPaletteSize - 2) level = kPaletteSize - 2;
+			image.SetPixel(xbin - 1, rows - ybin, 1 + std::lround(level));
+		}
+	}
+	return image;
+}
+
+void TikzImage::SetPixel(const unsigned int &x, const unsigned int &y,
+                         const unsigned char &index)
+{
+	pixels_[y * width_ + x] = index;
+}
+
+/** Write a PNG chunk with its length and checksum.
+ *
+ * \param[in] file The stream receiving the chunk.
+ * \param[in] type The four character chunk type.
+ * \param[in] data The chunk data.
+ */
+void TikzImage::WriteChunk(std::ostream &file, const char *type,
+                           const std::vector< unsigned char > &data)
+{
+	unsigned char header[8];
+	const unsigned long length = data.size();
+	for (int i = 0; i < 4; i++) header[i] = (length >> (24 - 8 * i)) & 0xff;
+	for (int i = 0; i < 4; i++) header[4 + i] = type[i];
+
+	unsigned long crc = crc32(0, header + 4, 4);
+	if (length) crc = crc32(crc, data.data(), length);
+	unsigned char trailer[4];
+	for (int i = 0; i < 4; i++) trailer[i] = (crc >> (24 - 8 * i)) & 0xff;
+
+	file.write(reinterpret_cast<const char*>(header), 8);
+	file.write(reinterpret_cast<const char*>(data.data()), length);
+	file.write(reinterpret_cast<const char*>(trailer), 4);
+}
+
+/** Write the image as a losslessly compressed 8 bit indexed color PNG with a
+ * transparent index zero.
+ *
+ * \param[in] filename The name of the PNG file.
+ */
+void TikzImage::WritePng(const std::string &filename) const {
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("ERROR: Unable to open image file '" + filename + "'!");
+	}
+
+	const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+	file.write(reinterpret_cast<const char*>(signature), 8);
+
+	//Image header: dimensions, 8 bit depth, indexed color.
+	std::vector< unsigned char > header(13, 0);
+	for (int i = 0; i < 4; i++) {
+		header[i] = (width_ >> (24 - 8 * i)) & 0xff;
+		header[4 + i] = (height_ >> (24 - 8 * i)) & 0xff;
+	}
+	header[8] = 8;
+	header[9] = 3;
+	WriteChunk(file, "IHDR", header);
+
+	std::vector< unsigned char > palette;
+	palette.reserve(3 * kPaletteSize);
+	for (auto &color : palette_) palette.insert(palette.end(), color.begin(), color.end());
+	WriteChunk(file, "PLTE", palette);
+
+	//Only the first palette entry is transparent.
+	WriteChunk(file, "tRNS", std::vector< unsigned char >(1, 0));
+
+	//Each row is preceded by its filter type, none.
+	std::vector< unsigned char > rows;
+	rows.reserve(height_ * (width_ + 1));
+	for (unsigned int row = 0; row < height_; row++) {
+		rows.push_back(0);
+		rows.insert(rows.end(), pixels_.begin() + row * width_,
+		            pixels_.begin() + (row + 1) * width_);
+	}
+	uLongf compressedSize = compressBound(rows.size());
+	std::vector< unsigned char > compressed(compressedSize);
+	if (compress2(compressed.data(), &compressedSize, rows.data(), rows.size(),
+	              Z_DEFAULT_COMPRESSION) != Z_OK) {
+		throw std::runtime_error("ERROR: Unable to compress image '" + filename + "'!");
+	}
+	compressed.resize(compressedSize);
+	WriteChunk(file, "IDAT", compressed);
+
+	WriteChunk(file, "IEND", std::vector< unsigned char >());
+}
@@ -0,0 +1,109 @@
+#include "TikzLatex.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	/// The cached conversions and the lock guarding them.
+	std::unordered_map< std::string, std::string > cache;
+	std::mutex cacheLock;
+
+	bool IsLetter(const char &c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+}
+
+/** Look up the string in the cache and convert it if it is not cached yet.
+ * The conversion is done outside of the lock.
+ *
+ * \param[in] str A ROOT TLatex string to be converted.
+ * \return A LaTeX formatted string.
+ */
+std::string TikzLatex::Get(const std::string &str) {
+	{
+		std::lock_guard< std::mutex > lock(cacheLock);
+		auto cached = cache.find(str);
+		if (cached != cache.end()) return cached->second;
+	}
+
+	std::string latex = Translate(str);
+
+	std::lock_guard< std::mutex > lock(cacheLock);
+	if (cache.size() >= kMaxCacheSize) cache.clear();
+	cache.emplace(str, latex);
+	return latex;
+}
+
+void TikzLatex::ClearCache() {
+	std::lock_guard< std::mutex > lock(cacheLock);
+	cache.clear();
+}
+
+/** Convert ROOT TLatex syntax into LaTeX in a single pass. A `#` followed by
+ * letters becomes a LaTeX command, `^` and `_` start a super or subscript,
+ * and each of these takes the following brace groups as arguments, in which
+ * `#` commands are converted as well. Consecutive math items are wrapped
+ * together in a single pair of `$`, e.g. `E_{#gamma} (keV)` becomes
+ * `E$_{\gamma}$ (keV)`. A `#` not followed by a letter is escaped.
+ *
+ * \param[in] str A ROOT TLatex string to be converted.
+ * \return A LaTeX formatted string.
+ */
+std::string TikzLatex::Translate(const std::string &str) {
+	const size_t length = str.size();
+	std::string latex;
+	latex.reserve(length + length / 4 + 2);
+
+	bool math = false;
+	size_t position = 0;
+	while (position < length) {
+		const char c = str[position];
+		const bool command = c == '#' && position + 1 < length && IsLetter(str[position + 1]);
+		if (!command && c != '^' && c != '_') {
+			if (math) latex.push_back('$');
+			math = false;
+			if (c == '#') latex.push_back('\\');
+			latex.push_back(c);
+			position++;
+			continue;
+		}
+
+		if (!math) latex.push_back('$');
+		math = true;
+
+		//The command name or the script character.
+		if (command) {
+			latex.push_back('\\');
+			for (position++; position < length && IsLetter(str[position]); position++) {
+				latex.push_back(str[position]);
+			}
+		}
+		else {
+			latex.push_back(c);
+			position++;
+			//A script without braces applies to a single character.
+			if (position < length && str[position] != '{') {
+				latex.push_back(str[position++]);
+				continue;
+			}
+		}
+
+		//The brace groups following the item.
+		while (position < length && str[position] == '{') {
+			int depth = 0;
+			do {
+				const char argument = str[position];
+				if (argument == '{') depth++;
+				else if (argument == '}') depth--;
+				if (argument == '#' && position + 1 < length && IsLetter(str[position + 1])) {
+					latex.push_back('\\');
+				}
+				else latex.push_back(argument);
+				position++;
+			} while (position < length && depth > 0);
+		}
+	}
+	if (math) latex.push_back('$');
+
+	return latex;
+}
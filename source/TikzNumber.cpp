@@ -0,0 +1,79 @@
+#include "TikzNumber.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+TikzNumber::TikzNumber(const double &value, const int &precision)
+{
+	length_ = Format(value, buffer_, precision);
+}
+
+/** Format a double into the provided buffer. Integral values are written
+ * directly as digits as this is the common case for histogram contents. If a
+ * precision is specified the value is written with that many significant
+ * digits, otherwise the shortest of 15, 16 or 17 significant digits that
+ * reproduces the value exactly is used.
+ *
+ * \param[in] value The value to be formatted.
+ * \param[out] buffer The output buffer, must hold at least kMaxLength chars.
+ * \param[in] precision The number of significant digits, zero selects the
+ * 	shortest round trip representation.
+ * \return The number of characters written, excluding the null terminator.
+ */
+size_t TikzNumber::Format(const double &value, char *buffer,
+                          const int &precision /* = 0 */)
+{
+	if (std::isnan(value)) {
+		buffer[0] = 'n'; buffer[1] = 'a'; buffer[2] = 'n'; buffer[3] = '\0';
+		return 3;
+	}
+
+	//Fast path for integers which can be written digit by digit.
+	if (std::fabs(value) < 1e15 && value == std::floor(value)) {
+		long long integer = static_cast<long long>(value);
+		char digits[20];
+		size_t nDigits = 0;
+		unsigned long long magnitude = integer < 0 ? -integer : integer;
+		do {
+			digits[nDigits++] = '0' + magnitude % 10;
+			magnitude /= 10;
+		} while (magnitude);
+
+		//Precision only matters if there are more digits than requested.
+		if (precision <= 0 || nDigits <= static_cast<size_t>(precision)) {
+			size_t length = 0;
+			if (integer < 0) buffer[length++] = '-';
+			while (nDigits) buffer[length++] = digits[--nDigits];
+			buffer[length] = '\0';
+			return length;
+		}
+	}
+
+	if (std::isinf(value)) {
+		size_t length = 0;
+		if (value < 0) buffer[length++] = '-';
+		buffer[length++] = 'i'; buffer[length++] = 'n'; buffer[length++] = 'f';
+		buffer[length] = '\0';
+		return length;
+	}
+
+	if (precision > 0) {
+		int digits = precision > 17 ? 17 : precision;
+		return std::snprintf(buffer, kMaxLength, "%.*g", digits, value);
+	}
+
+	//Find the shortest representation that round trips.
+	int length = 0;
+	for (int digits = 15; digits < 17; digits++) {
+		length = std::snprintf(buffer, kMaxLength, "%.*g", digits, value);
+		if (std::strtod(buffer, nullptr) == value) return length;
+	}
+	return std::snprintf(buffer, kMaxLength, "%.17g", value);
+}
+
+/** Write the formatted number to the stream as a block of characters.
+ */
+std::ostream& operator<<(std::ostream &output, const TikzNumber &number) {
+	return output.write(number.c_str(), number.size());
+}
@@ -1,62 +1,199 @@
 #include "TikzOptions.hpp"
 
-#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
 
-TikzOptions::TikzOptions(std::string options)
-	: std::map< std::string, std::string >()
-{
+namespace {
+	/// Check if a character is white space stripped from options.
+	bool IsSpace(const char &c) {
+		return c == ' ' || c == '\t' || c == '\n';
+	}
+}
+
+TikzOptions::TikzOptions(const std::string &options) {
 	Add(options);
 }
 
 /** Add some tikz options, can be a single options or a list of options
  * spearated by commas. Arguments containing commas should be wrapped in curly
- * brackets. Leading and trailing white space will be stripped from the option
- * name and argument.
+ * brackets, which may be nested. Leading and trailing white space will be
+ * stripped from the option name and argument. An option without an equal
+ * sign has an empty argument. The string is tokenized in a single pass and
+ * repeated options are removed afterwards.
  *
  * \param[in] options The options to be added.
  */
 void TikzOptions::Add(const std::string &options) {
-	//If the string is empty do nothing.
-	if (options == "") return;
+	const size_t first = options_.size();
+	const char *data = options.data();
+	const size_t length = options.size();
 
-	//Loop over every option assuming the brek is on a comma.
+	//Split on the commas outside of curly brackets.
 	size_t start = 0;
-	size_t end = options.find_first_of(",");
-	while (end != std::string::npos) {
-		//Check if we are between curly brackets, if so find the next comma and
-		//continue without parsing the current broken argument
-		if (end > options.find_last_of("{") && end < options.find_first_of("}")) {
-			end = options.find_first_of(",", end + 1);
-			continue;
+	int depth = 0;
+	for (size_t position = 0; position < length; position++) {
+		const char c = data[position];
+		if (c == '{') depth++;
+		else if (c == '}' && depth > 0) depth--;
+		else if (c == ',' && depth == 0) {
+			AddOption(data + start, data + position);
+			start = position + 1;
+		}
+	}
+	AddOption(data + start, data + length);
+	RemoveDuplicates(first);
+}
+
+/** Remove the added options whose name is already defined, keeping the
+ * first argument. Short lists are searched directly, longer ones use a set
+ * of the names so that adding many options takes linear time.
+ *
+ * \param[in] first The index of the first added option.
+ */
+void TikzOptions::RemoveDuplicates(const size_t &first) {
+	const size_t size = options_.size();
+	if (first == size) return;
+
+	std::unordered_set< std::string > names;
+	const bool indexed = size > kIndexSize;
+	if (indexed) {
+		names.reserve(size);
+		for (size_t index = 0; index < first; index++) names.insert(options_[index].first);
+	}
+
+	size_t kept = first;
+	for (size_t index = first; index < size; index++) {
+		bool defined = false;
+		if (indexed) defined = !names.insert(options_[index].first).second;
+		else {
+			for (size_t other = 0; other < kept && !defined; other++) {
+				defined = options_[other].first == options_[index].first;
+			}
 		}
+		if (defined) continue;
+		if (kept != index) {
+			options_[kept] = std::move(options_[index]);
+			hasArgument_[kept] = hasArgument_[index];
+		}
+		kept++;
+	}
+	options_.erase(options_.begin() + kept, options_.end());
+	hasArgument_.erase(hasArgument_.begin() + kept, hasArgument_.end());
+}
+
+/** Strip the option, split it on the first equal sign outside of curly
+ * brackets and append it unless it is empty.
+ *
+ * \param[in] first The first character of the option.
+ * \param[in] last One past the last character of the option.
+ */
+void TikzOptions::AddOption(const char *first, const char *last) {
+	while (first < last && IsSpace(*first)) first++;
+	while (last > first && IsSpace(*(last - 1))) last--;
+	if (first == last) return;
+
+	const char *equal = last;
+	int depth = 0;
+	for (const char *c = first; c < last; c++) {
+		if (*c == '{') depth++;
+		else if (*c == '}' && depth > 0) depth--;
+		else if (*c == '=' && depth == 0) {
+			equal = c;
+			break;
+		}
+	}
+
+	const char *nameLast = equal;
+	while (nameLast > first && IsSpace(*(nameLast - 1))) nameLast--;
+	const char *argument = equal < last ? equal + 1 : last;
+	while (argument < last && IsSpace(*argument)) argument++;
+
+	options_.emplace_back(std::string(first, nameLast), std::string(argument, last));
+	hasArgument_.push_back(equal < last);
+}
 
-		//Emplace the parsed argument into the map.
-		this->emplace(ParseOption(options.substr(start, end - start)));
+bool TikzOptions::IsDefined(const std::string &optionName) const {
+	return find(optionName) != end();
+}
+
+/**
+ * \param[in] optionName The name of the option.
+ * \return True if the option is defined and was given with an equal sign or
+ * 	assigned an argument.
+ */
+bool TikzOptions::HasArgument(const std::string &optionName) const {
+	auto option = find(optionName);
+	if (option == end()) return false;
+	return hasArgument_[option - begin()];
+}
+
+/**
+ * \param[in] optionName The name of the option.
+ * \return A reference to the argument, which is only valid until the next
+ * 	option is added.
+ */
+std::string &TikzOptions::operator[](const std::string &optionName) {
+	auto option = find(optionName);
+	if (option != end()) return option->second;
+	options_.emplace_back(optionName, "");
+	hasArgument_.push_back(true);
+	return options_.back().second;
+}
 
-		//Compute the start and end positions of the next option.
-		start = end + 1;
-		end = options.find_first_of(",", start);
+std::string &TikzOptions::at(const std::string &optionName) {
+	auto option = find(optionName);
+	if (option == end()) {
+		throw std::out_of_range("ERROR: Option '" + optionName + "' is not defined!");
 	}
-	//Emplace the remaining option.
-	this->emplace(ParseOption(options.substr(start)));
+	return option->second;
 }
 
-bool TikzOptions::IsDefined(const std::string &optionName) {
-	if (this->find(optionName) != this->end())
-		return true;
-	return false;
+const std::string &TikzOptions::at(const std::string &optionName) const {
+	auto option = find(optionName);
+	if (option == end()) {
+		throw std::out_of_range("ERROR: Option '" + optionName + "' is not defined!");
+	}
+	return option->second;
+}
+
+TikzOptions::iterator TikzOptions::find(const std::string &optionName) {
+	for (auto option = options_.begin(); option != options_.end(); ++option) {
+		if (option->first == optionName) return option;
+	}
+	return options_.end();
+}
+
+TikzOptions::const_iterator TikzOptions::find(const std::string &optionName) const {
+	for (auto option = options_.begin(); option != options_.end(); ++option) {
+		if (option->first == optionName) return option;
+	}
+	return options_.end();
+}
+
+/** The order of the remaining options is kept.
+ *
+ * \param[in] optionName The name of the option to be removed.
+ * \return The number of removed options, zero or one.
+ */
+size_t TikzOptions::erase(const std::string &optionName) {
+	auto option = find(optionName);
+	if (option == end()) return 0;
+	hasArgument_.erase(hasArgument_.begin() + (option - begin()));
+	options_.erase(option);
+	return 1;
 }
 
 /** Parses a tikz option string by separating on the first equal sign.
  *
  * \param[in] option The option to be parsed.
  * \return A pair where the first item is the option name and the second is
- *  	the argument.
+ *  	the argument, which is empty if there is no equal sign.
  */
 std::pair< std::string, std::string> TikzOptions::ParseOption(const std::string &option) {
 	size_t equal_loc = option.find_first_of("=");
 	std::string optionName = Strip(option.substr(0, equal_loc));
-	std::string optionArgument = Strip(option.substr(equal_loc+1));
+	std::string optionArgument;
+	if (equal_loc != std::string::npos) optionArgument = Strip(option.substr(equal_loc+1));
 
 	return make_pair(optionName, optionArgument);
 }
@@ -69,15 +206,39 @@ std::pair< std::string, std::string> TikzOptions::ParseOption(const std::string
  */
 std::string TikzOptions::Strip(const std::string &str) {
 	size_t begin = str.find_first_not_of(" \t\n");
+	if (begin == std::string::npos) return "";
 	size_t end = str.find_last_not_of(" \t\n") + 1;
 	return str.substr(begin, end - begin);
 }
 
+/** Each option is written on its own line followed by a comma. Options
+ * given without an equal sign are written without one.
+ *
+ * \param[out] output The string the options are appended to.
+ * \param[in] indent The indentation of each line.
+ */
+void TikzOptions::AppendString(std::string &output,
+                               const std::string &indent) const
+{
+	size_t length = output.size();
+	for (auto &option : options_) {
+		length += indent.size() + option.first.size() + option.second.size() + 3;
+	}
+	output.reserve(length);
 
-std::string TikzOptions::GetString() {
-	std::stringstream output;
-	for (auto option : *this) {
-		output << "\t\t\t" << option.first << "=" << option.second << ",\n";
+	for (size_t index = 0; index < options_.size(); index++) {
+		output.append(indent);
+		output.append(options_[index].first);
+		if (hasArgument_[index] || !options_[index].second.empty()) {
+			output.push_back('=');
+			output.append(options_[index].second);
+		}
+		output.append(",\n");
 	}
-	return output.str();
+}
+
+std::string TikzOptions::GetString() const {
+	std::string output;
+	AppendString(output);
+	return output;
 }
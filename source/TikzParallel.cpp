@@ -0,0 +1,87 @@
+#include "TikzParallel.hpp"
+
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \param[in] nThreads The requested number of threads, zero selects the
+ * 	number of hardware threads.
+ * \return The number of threads.
+ */
+unsigned int TikzParallel::GetThreads(const unsigned int &nThreads) {
+	if (nThreads) return nThreads;
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads ? hardwareThreads : 1;
+}
+
+/** Run tasks concurrently on a work stealing set of threads. The calling
+ * thread takes part as the first worker. If a task throws, the remaining
+ * tasks are still run and the first exception is rethrown afterwards.
+ *
+ * \param[in] nTasks The number of tasks.
+ * \param[in] nThreads The number of threads, zero selects the number of
+ * 	hardware threads.
+ * \param[in] task The function called with the index of each task.
+ */
+void TikzParallel::For(const size_t &nTasks, const unsigned int &nThreads,
+                       const std::function< void(const size_t&) > &task)
+{
+	unsigned int nWorkers = GetThreads(nThreads);
+	if (nWorkers > nTasks) nWorkers = nTasks;
+	if (nWorkers <= 1) {
+		for (size_t index = 0; index < nTasks; index++) task(index);
+		return;
+	}
+
+	//Each worker owns a queue with a contiguous block of the tasks.
+	std::vector< std::deque< size_t > > queues(nWorkers);
+	std::vector< std::mutex > locks(nWorkers);
+	for (size_t index = 0; index < nTasks; index++) {
+		queues[index * nWorkers / nTasks].push_back(index);
+	}
+
+	std::exception_ptr error;
+	std::mutex errorLock;
+
+	auto Worker = [&](const unsigned int &worker) {
+		while (true) {
+			size_t index = nTasks;
+			//Take the next task from the front of the own queue, otherwise
+			//steal from the back of the other queues.
+			for (unsigned int offset = 0; offset < nWorkers && index == nTasks; offset++) {
+				const unsigned int victim = (worker + offset) % nWorkers;
+				std::lock_guard< std::mutex > lock(locks[victim]);
+				if (queues[victim].empty()) continue;
+				if (offset == 0) {
+					index = queues[victim].front();
+					queues[victim].pop_front();
+				}
+				else {
+					index = queues[victim].back();
+					queues[victim].pop_back();
+				}
+			}
+			if (index == nTasks) return;
+
+			try {
+				task(index);
+			}
+			catch (...) {
+				std::lock_guard< std::mutex > lock(errorLock);
+				if (!error) error = std::current_exception();
+			}
+		}
+	};
+
+	std::vector< std::thread > threads;
+	for (unsigned int worker = 1; worker < nWorkers; worker++) {
+		threads.emplace_back(Worker, worker);
+	}
+	Worker(0);
+	for (auto &thread : threads) thread.join();
+
+	if (error) std::rethrow_exception(error);
+}
@@ -1,11 +1,21 @@
 #include "TikzPicture.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 
 #include "PgfPlotsGroupPlot.hpp"
+#include "TikzFileBuffer.hpp"
+#include "TikzHash.hpp"
+
+const unsigned int TikzPicture::kFormatVersion;
 
 TikzPicture::TikzPicture(const std::string &options, const std::string &preamble)
-	: options_(options), preamble_(preamble), colorbrewer2_palette_("")
+	: options_(options), preamble_(preamble), colorbrewer2_palette_(""),
+	  externalData_(false), incremental_(false), externalize_(false),
+	  report_(false), texMemory_(TikzReport::kTexMainMemory), budget_(0),
+	  pageBreak_("\\clearpage")
 {
 
 }
@@ -40,36 +50,354 @@ void TikzPicture::SetPalette(std::string colorbrewer2_palette) {
 	colorbrewer2_palette_ = colorbrewer2_palette;
 }
 
-/**Creates a TikZ picture using with the provided axis.
+/** The hash covers the options, styles and data of every axis and plot,
+ * with histogram data taken from the raw bin arrays. It is much cheaper to
+ * compute than the written picture. The output format version is included
+ * so that pictures written by an older version of the library are rewritten.
+ *
+ * \return The hash as a string of hexadecimal digits.
+ */
+std::string TikzPicture::GetHash() {
+	TikzHash hash;
+	hash.AddValue(kFormatVersion);
+	hash.Add(preamble_);
+	hash.Add(colorbrewer2_palette_);
+	hash.Add(options_);
+	hash.AddValue(externalData_);
+	hash.AddValue(externalize_);
+	hash.AddValue(budget_);
+	hash.Add(pageBreak_);
+	hash.AddValue(axes_.size());
+	for (auto axis : axes_) {
+		axis->Hash(hash);
+	}
+	return hash.GetString();
+}
+
+/** The budget is divided among the plots of all axes. Plots needing less
+ * than an equal share for their lossless representation keep it, and the
+ * coordinates they leave unused are shared among the remaining plots. Each
+ * plot then selects its representation within its share, see
+ * PgfPlotsPlot::SetBudget. Plots with a smaller budget of their own keep it.
+ *
+ * \return The plots and the budgets to be restored after the write.
+ */
+std::vector< std::pair< PgfPlotsPlot*, size_t > > TikzPicture::DistributeBudget() {
+	std::vector< std::pair< size_t, PgfPlotsPlot* > > costs;
+	for (auto axis : axes_) {
+		for (auto plot : axis->GetPlots()) {
+			costs.push_back(std::make_pair(plot->GetLosslessCoordinates(), plot));
+		}
+	}
+	std::stable_sort(costs.begin(), costs.end(),
+		[](const std::pair< size_t, PgfPlotsPlot* > &a,
+		   const std::pair< size_t, PgfPlotsPlot* > &b) {return a.first < b.first;});
+
+	std::vector< std::pair< PgfPlotsPlot*, size_t > > previousBudgets;
+	size_t remaining = budget_;
+	for (size_t index = 0; index < costs.size(); index++) {
+		PgfPlotsPlot *plot = costs[index].second;
+		const size_t share = std::max< size_t >(remaining / (costs.size() - index), 1);
+		remaining -= std::min(std::min(costs[index].first, share), remaining);
+
+		previousBudgets.push_back(std::make_pair(plot, plot->GetBudget()));
+		if (!plot->GetBudget() || plot->GetBudget() > share) plot->SetBudget(share);
+	}
+	return previousBudgets;
+}
+
+/** A file is unchanged if its hash file, e.g. fig.tex.hash for fig.tex,
+ * contains the given hash and the file and all its tables and images exist.
+ *
+ * \param[in] filename The name of the picture file.
+ * \param[in] hash The hash of the current content.
+ * \return True if the file does not need to be written.
+ */
+bool TikzPicture::IsUnchanged(const std::string &filename,
+                              const std::string &hash)
+{
+	std::ifstream hashFile(filename + ".hash");
+	std::string storedHash;
+	if (!(hashFile >> storedHash) || storedHash != hash) return false;
+
+	std::vector< std::string > files = {filename};
+	for (auto axis : axes_) {
+		for (auto plot : axis->GetPlots()) {
+			if (plot->GetTableFile() != "") files.push_back(plot->GetTableFile());
+			if (plot->GetRenderImage() != "") files.push_back(plot->GetRenderImage());
+		}
+	}
+	for (auto file : files) {
+		if (!std::ifstream(file)) return false;
+	}
+	return true;
+}
+
+/**Creates a TikZ picture using with the provided axis. If external data is
+ * enabled each plot without a table file writes its coordinates to a table
+ * named after the picture file, e.g. fig.tex produces fig-1.dat, fig-2.dat,
+ * numbered in the order the plots are written.
+ *
+ * In incremental mode the hash of the content, see GetHash, is stored next
+ * to the file. If the file was written from identical content it is left
+ * untouched, so its modification time does not trigger downstream builds.
+ *
+ * If externalization is enabled the picture is named with
+ * \\tikzsetnextfilename after the file and the content hash, e.g.
+ * fig-0123456789abcdef. The name does not depend on the position of the
+ * picture in the document, so the TikZ external library reuses the compiled
+ * figure until its content changes. The document must enable the library
+ * with \\tikzexternalize.
+ *
+ * If a budget is set it is divided among the plots before writing, see
+ * DistributeBudget, and the representation selected for each plot is given
+ * in the report.
+ *
+ * The cost of the write is recorded in a report, see GetReport. If the
+ * estimated TeX memory of an axis exceeds the limit set with SetTexMemory a
+ * warning is printed. If the report is enabled it is written as JSON next to
+ * the file, e.g. fig.tex.json.
  *
  * \param[in] filename
  */
 void TikzPicture::Write(const std::string &filename /* = "" */) {
-	std::streambuf *buf = std::cout.rdbuf();
+	auto start = std::chrono::steady_clock::now();
+	pictureReport_ = TikzReport::Picture();
+	pictureReport_.filename = filename;
+
+	std::string hash;
+	if (incremental_ && filename == "") {
+		std::cerr << "WARNING: Incremental writing requires an output file, the picture is always written.\n";
+	}
+	else if (incremental_) {
+		hash = GetHash();
+	}
+
+	std::string externalName;
+	if (externalize_) {
+		size_t extension = filename.find_last_of(".");
+		size_t directory = filename.find_last_of("/");
+		if (directory == std::string::npos) directory = 0;
+		else directory++;
+		if (extension < directory) extension = std::string::npos;
+		externalName = filename.substr(directory, extension - directory);
+		if (externalName != "") externalName += "-";
+		externalName += hash != "" ? hash : GetHash();
+	}
+	pictureReport_.hashSeconds = std::chrono::duration< double >(
+		std::chrono::steady_clock::now() - start).count();
+
+	std::vector< PgfPlotsPlot* > tablePlots;
+	if (externalData_ && filename == "") {
+		std::cerr << "WARNING: External data requires an output file, data will be written inline.\n";
+	}
+	else if (externalData_) {
+		unsigned int tableId = 0;
+		for (auto axis : axes_) {
+			for (auto plot : axis->GetPlots()) {
+				tableId++;
+				if (plot->GetTableFile() != "") continue;
+				plot->SetTableFile(GetTableFile(filename, tableId));
+				tablePlots.push_back(plot);
+			}
+		}
+	}
+
+	pictureReport_.unchanged = hash != "" && IsUnchanged(filename, hash);
+	if (!pictureReport_.unchanged) {
+		//The stored hash is removed until the new content is complete.
+		if (hash != "") std::remove((filename + ".hash").c_str());
+
+		std::vector< std::pair< PgfPlotsPlot*, size_t > > previousBudgets;
+		if (budget_) previousBudgets = DistributeBudget();
+
+		//A file is collected in memory and committed in a single write.
+		std::streambuf *buf = std::cout.rdbuf();
+		TikzFileBuffer fileBuffer;
+		if (filename != "") {
+			fileBuffer.Reserve(EstimateBytes());
+			buf = &fileBuffer;
+		}
+
+		TikzReport::CountingBuffer counter(buf);
+		try {
+			WritePicture(&counter, externalName);
+			if (filename != "") fileBuffer.Commit(filename);
+		}
+		catch (...) {
+			for (auto &plotBudget : previousBudgets) {
+				plotBudget.first->SetBudget(plotBudget.second);
+			}
+			for (auto plot : tablePlots) plot->SetTableFile("");
+			throw;
+		}
+		pictureReport_.bytes = counter.GetCount();
+
+		for (auto &plotBudget : previousBudgets) {
+			plotBudget.first->SetBudget(plotBudget.second);
+		}
+
+		if (hash != "") {
+			TikzFileBuffer hashBuffer(hash.size() + 1);
+			hashBuffer.sputn(hash.data(), hash.size());
+			hashBuffer.sputc('\n');
+			hashBuffer.Commit(filename + ".hash");
+		}
+	}
+
+	//Restore the plots whose table files were assigned here.
+	for (auto plot : tablePlots) {
+		plot->SetTableFile("");
+	}
+
+	pictureReport_.seconds = std::chrono::duration< double >(
+		std::chrono::steady_clock::now() - start).count();
+	if (!pictureReport_.unchanged) {
+		//The axes are typeset one after another, so the largest one counts.
+		for (auto &axisReport : pictureReport_.axes) {
+			pictureReport_.texMemory = std::max(pictureReport_.texMemory,
+				axisReport.texMemory);
+		}
+	}
+	if (pictureReport_.texMemory > texMemory_) {
+		std::cerr << "WARNING: Picture '" << filename << "' needs an estimated "
+			<< pictureReport_.texMemory << " words of TeX memory, more than the "
+			<< texMemory_ << " available, and may fail with 'TeX capacity exceeded'!\n";
+	}
+
+	if (report_ && filename == "") {
+		std::cerr << "WARNING: The report requires an output file and is not written.\n";
+	}
+	else if (report_) {
+		std::ofstream reportFile(filename + ".json");
+		TikzReport::WriteJson(pictureReport_, reportFile);
+	}
+}
+
+/** The tables are named after the picture file without its extension and
+ * numbered in the order of the plots, e.g. fig-1.dat.
+ *
+ * \param[in] filename The picture file name.
+ * \param[in] tableId The number of the plot, starting from one.
+ * \return The table file name.
+ */
+std::string TikzPicture::GetTableFile(const std::string &filename,
+                                      const unsigned int &tableId)
+{
+	size_t extension = filename.find_last_of(".");
+	size_t directory = filename.find_last_of("/");
+	if (directory != std::string::npos && extension < directory) {
+		extension = std::string::npos;
+	}
+	return filename.substr(0, extension) + "-" + std::to_string(tableId) + ".dat";
+}
+
+/** The files are the picture, its hash and report if enabled, the external
+ * data tables and the rendered images, as written with the current settings.
+ * A picture written to the standard output is given by an empty name.
+ *
+ * \param[in] filename The picture file name.
+ * \return The file names.
+ */
+std::vector< std::string > TikzPicture::GetOutputFiles(const std::string &filename) {
+	std::vector< std::string > files(1, filename);
+	if (filename == "") return files;
+	if (incremental_) files.push_back(filename + ".hash");
+	if (report_) files.push_back(filename + ".json");
+
+	unsigned int tableId = 0;
+	for (auto axis : axes_) {
+		for (auto plot : axis->GetPlots()) {
+			tableId++;
+			if (plot->GetRenderImage() != "" && plot->GetHist2d()) {
+				files.push_back(plot->GetRenderImage());
+			}
+			else if (plot->GetTableFile() != "") files.push_back(plot->GetTableFile());
+			else if (externalData_) files.push_back(GetTableFile(filename, tableId));
+		}
+	}
+	return files;
+}
 
-	std::ofstream outputStream;
-	if (filename != "") {
-		outputStream.open(filename);
-		buf = outputStream.rdbuf();
+/** The estimate covers the preamble, the axis headers and the inline data
+ * of the plots.
+ *
+ * \return The estimated size of the written picture in bytes.
+ */
+size_t TikzPicture::EstimateBytes() {
+	size_t bytes = preamble_.size() + kBytesPerAxis;
+	for (auto axis : axes_) {
+		bytes += kBytesPerAxis;
+		for (auto plot : axis->GetPlots()) bytes += plot->EstimateBytes();
 	}
-	std::ostream output(buf);
+	return bytes;
+}
+
+/** Write the preamble and the picture environment containing the axes.
+ * Paginated group plots are written one page per picture environment,
+ * separated by the page break. The other axes are repeated on every page,
+ * so that each page is complete. Externalized pages after the first are
+ * named after the picture with the page number.
+ *
+ * \param[in] buf The buffer that the picture should be written into.
+ * \param[in] externalName The name of the externalized figure, empty if the
+ * 	picture is not externalized.
+ */
+void TikzPicture::WritePicture(std::streambuf *buf,
+                               const std::string &externalName)
+{
+	std::string header;
 
 	if (preamble_ != "") {
-		output << preamble_ << "\n";
+		header.append(preamble_);
+		header.push_back('\n');
+	}
+
+	if (externalName != "") {
+		header.append("\\usetikzlibrary{external}\n");
 	}
 
 	if (colorbrewer2_palette_ != "") {
-		output << "\\usepgfplotslibrary{colorbrewer}\n"
-			"\\pgfplotsset{cycle list/" << colorbrewer2_palette_ << "}\n";
+		header.append("\\usepgfplotslibrary{colorbrewer}\n"
+			"\\pgfplotsset{cycle list/" + colorbrewer2_palette_ + "}\n");
 	}
 
-	output << "\\begin{tikzpicture}\n";
+	if (externalName != "") {
+		header.append("\\tikzsetnextfilename{" + externalName + "}\n");
+	}
 
+	header.append("\\begin{tikzpicture}\n");
+	buf->sputn(header.data(), header.size());
+
+	unsigned int pages = 1;
 	for (auto axis : axes_) {
-		axis->Write(buf);
+		auto group = dynamic_cast<PgfPlotsGroupPlot*>(axis);
+		if (group) pages = std::max(pages, group->GetPages());
 	}
 
-	output << "\\end{tikzpicture}\n";
+	for (unsigned int page = 0; page < pages; page++) {
+		if (page) {
+			std::string pageStart = "\\end{tikzpicture}\n" + pageBreak_ + "\n";
+			if (externalName != "") {
+				pageStart += "\\tikzsetnextfilename{" + externalName + "-"
+					+ std::to_string(page + 1) + "}\n";
+			}
+			pageStart += "\\begin{tikzpicture}\n";
+			buf->sputn(pageStart.data(), pageStart.size());
+		}
+
+		for (auto axis : axes_) {
+			auto group = dynamic_cast<PgfPlotsGroupPlot*>(axis);
+			if (group && group->GetPages() > 1) {
+				if (page >= group->GetPages()) continue;
+				group->SetPage(page);
+			}
+			axis->Write(buf);
+			if (group) group->SetPage(0);
+			pictureReport_.axes.push_back(axis->GetReport());
+		}
+	}
 
-	if (outputStream.is_open()) {outputStream.close();}
+	static const std::string footer = "\\end{tikzpicture}\n";
+	buf->sputn(footer.data(), footer.size());
 }
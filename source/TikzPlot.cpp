@@ -10,6 +10,10 @@
 
 #include <TH1.h>
 
+#include "TikzImage.hpp"
+#include "TikzLatex.hpp"
+#include "TikzWriter.hpp"
+
 TikzPlot::TikzPlot() :
 	logMode_({false}), is2dColor_(false), colorbrewer2_palette_("")
 {
@@ -65,6 +69,10 @@ void TikzPlot::Add(TH2* hist, const std::string &options /* = "" */) {
 	//Check if the axis titles are set, if not use them form this hist.
 	if (axisTitles_.at(0) == "") axisTitles_.at(0) = hist->GetXaxis()->GetTitle();
 	if (axisTitles_.at(1) == "") axisTitles_.at(1) = hist->GetYaxis()->GetTitle();
+
+	//The axis limits are the histogram range.
+	axisLimits_.at(0) = std::make_pair(hist->GetXaxis()->GetXmin(), hist->GetXaxis()->GetXmax());
+	axisLimits_.at(1) = std::make_pair(hist->GetYaxis()->GetXmin(), hist->GetYaxis()->GetXmax());
 }
 
 void TikzPlot::SetLog(const short &axis, const bool &logMode /* = true */) {
@@ -98,26 +106,8 @@ void TikzPlot::SetPalette(std::string colorbrewer2_palette) {
 	colorbrewer2_palette_ = colorbrewer2_palette;
 }
 
-std::string TikzPlot::GetLatexString(std::string str) {
-	//Replace # with \ and wrap in $.
-	std::size_t loc = str.find_first_of("#");
-	while (loc != std::string::npos) {
-		str[loc] = '\\';
-		str.insert(loc++, "$");
-		loc = str.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ", loc+1);
-		str.insert(loc, "$");
-		loc = str.find_first_of("#", loc);
-	}
-	//Wrap math commands in $
-	loc = str.find_first_of("{");
-	while (loc != std::string::npos) {
-		loc = str.find_last_of(" \\^_", loc);
-		str.insert(loc++, "$");
-		loc = str.find_first_of("}", loc+1);
-		str.insert(++loc, "$");
-		loc = str.find_first_of("{", loc);
-	}
-	return str;
+std::string TikzPlot::GetLatexString(const std::string &str) {
+	return TikzLatex::Get(str);
 }
 
 std::string TikzPlot::LogModeOptions() {
@@ -168,8 +158,11 @@ void TikzPlot::Write(const std::string &filename /* = "" */) {
 	if (is2dColor_) {
 		TH1 *hist = hists_.at(0).first;
 
-		output << ",\n"
-			"\t\tview={0}{90}, \%Top down view.\n"
+		output << ",\n";
+		//A rendered image is placed in a two-dimensional axis.
+		if (imageName_ != "") output << "\t\taxis on top,\n";
+		else output << "\t\tview={0}{90}, \%Top down view.\n";
+		output <<
 			"\t\tcolorbar, colorbar style={\n"
 			"\t\t\t\%To place the label on top of the colorbar use `title` instead of `ylabel`.\n"
 			"\t\t\tylabel={" << hist->GetZaxis()->GetTitle() << "}\n"
@@ -181,7 +174,7 @@ void TikzPlot::Write(const std::string &filename /* = "" */) {
 				hist->GetBinContent(hist->GetMinimumBin()) << ":" <<
 				hist->GetBinContent(hist->GetMaximumBin()) << "\n";
 
-		output <<
+		if (imageName_ == "") output <<
 			"\% Uses `matrix plot` which creates a filled patch at the middle\n"
 			"\% of the coordinates provided. The `surf` type plot is similar,\n"
 			"\% but expects the values of the corners to be provided. This   \n"
@@ -200,7 +193,9 @@ void TikzPlot::Write(const std::string &filename /* = "" */) {
 	for (auto itr : hists_) {
 		TH1* &hist = itr.first;
 		std::string &options = itr.second;
-		if (TH2* hist2d = dynamic_cast<TH2*>(hist)) PlotTH2(hist2d, options, buf);
+		TH2* hist2d = dynamic_cast<TH2*>(hist);
+		if (hist2d && imageName_ != "") PlotImage(hist2d, imageName_, buf);
+		else if (hist2d) PlotTH2(hist2d, options, buf);
 		else PlotTH1(hist, options, buf);
 	}
 
@@ -228,7 +223,7 @@ void TikzPlot::PlotTH1(const TH1 *hist, const std::string &options,
 	if (options.find("E") != std::string::npos) includeErrors = true;
 	if (options.find("E1") != std::string::npos) errorMarks = true;
 
-	std::ostream output(buf);
+	TikzWriter output(buf);
 
 	//Setup the plot style
 	output << "\t\\addplot+[";
@@ -263,15 +258,16 @@ void TikzPlot::PlotTH1(const TH1 *hist, const std::string &options,
 			if (includeErrors) output << hist->GetBinCenter(xbin);
 			else output << hist->GetBinLowEdge(xbin);
 			output << "," << hist->GetBinContent(xbin) << ") ";
-			if (includeErrors) output << " +- (" << hist->GetBinWidth(xbin) / 2 <<
-				"," << hist->GetBinError(xbin) << ") ";
+			if (includeErrors) output << " +- (" <<
+				hist->GetBinWidth(xbin) / 2 << "," <<
+				hist->GetBinError(xbin) << ") ";
 		}
 	}
 
 	//Add a final coordinate to extend the right edge of the last bin to zero.
 	if (!includeErrors) {
 		output << "(" << hist->GetBinLowEdge(hist->GetNbinsX()) +
-			hist->GetBinWidth(hist->GetNbinsX()) << "," << 0 << ") ";
+			hist->GetBinWidth(hist->GetNbinsX()) << ",0) ";
 	}
 
 	//Coordinate list trailer.
@@ -302,7 +298,7 @@ void TikzPlot::PlotTH2(const TH2 *hist, const std::string &options,
 		surfPlot = true;
 	}
 
-	std::ostream output(buf);
+	TikzWriter output(buf);
 
 	output <<
 		"\t\\addplot3[";
@@ -326,15 +322,36 @@ void TikzPlot::PlotTH2(const TH2 *hist, const std::string &options,
 			if (surfPlot) xvalue = hist->GetXaxis()->GetBinLowEdge(xbin);
 			else xvalue = hist->GetXaxis()->GetBinCenter(xbin);
 			double weight = hist->GetBinContent(xbin, ybin);
-			output << "(" << xvalue << "," << yvalue << "," << weight << ") ";
+			output << '(' << xvalue << ',' << yvalue << ',' << weight << ") ";
 		}
-		output << "\n";
+		output << '\n';
 	}
 
 	//Coordinate list trailer.
 	output << "\t\t};\n";
 }
 
+/**Renders the histogram to an indexed color PNG, one pixel per bin, using
+ * the default pgfplots colormap and the histogram minimum and maximum as the
+ * color bar limits. The image is placed in the axis with `\addplot graphics`.
+ *
+ * \param[in] hist Pointer to the histogram to be plotted.
+ * \param[in] imageName The name of the image file to be written.
+ * \param[in] buf The streambuf that the output should be directed to. The default is directed to std::cout.
+ */
+void TikzPlot::PlotImage(const TH2 *hist, const std::string &imageName,
+		std::streambuf *buf /* = std::cout.rdbuf() */)
+{
+	TikzImage::FromTH2(hist, hist->GetMinimum(), hist->GetMaximum()).WritePng(imageName);
+
+	TikzWriter output(buf);
+	output << "\t\\addplot graphics[xmin=" << hist->GetXaxis()->GetXmin()
+		<< ", xmax=" << hist->GetXaxis()->GetXmax()
+		<< ", ymin=" << hist->GetYaxis()->GetXmin()
+		<< ", ymax=" << hist->GetYaxis()->GetXmax()
+		<< "] {" << imageName << "};\n";
+}
+
 /**TikZ is capable of using a previously rendered image and placing it within
  * axes that are rendered by TikZ. This can be useful in situations when
  * rendering a histogram with TikZ would be too time consuming, such as a 2D
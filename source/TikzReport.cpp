@@ -0,0 +1,100 @@
+#include "TikzReport.hpp"
+
+#include <cstdio>
+
+namespace {
+	/// Main memory words pgfplots keeps for each coordinate of an axis.
+	const size_t kWordsPerCoordinate = 60;
+}
+
+/**
+ * \param[in] output The stream receiving the string literal.
+ * \param[in] str The string to be quoted and escaped.
+ */
+void TikzReport::WriteJsonString(std::ostream &output, const std::string &str) {
+	output << '"';
+	for (char c : str) {
+		if (c == '"' || c == '\\') output << '\\' << c;
+		else if (c == '\n') output << "\\n";
+		else if (c == '\t') output << "\\t";
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			char escape[8];
+			std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+			output << escape;
+		}
+		else output << c;
+	}
+	output << '"';
+}
+
+/** pgfplots reads the whole coordinate list of a plot as a token list and
+ * keeps every parsed coordinate of an axis in memory until the axis is
+ * finished. The estimate is one word per byte of the plot command and a
+ * fixed number of words per coordinate. It is only meant to be accurate
+ * to a factor of about two.
+ *
+ * \param[in] coordinates The number of coordinates written.
+ * \param[in] bytes The number of bytes of inline plot output.
+ * \return The estimated main memory in words.
+ */
+size_t TikzReport::EstimateTexMemory(const size_t &coordinates,
+                                     const size_t &bytes)
+{
+	return kWordsPerCoordinate * coordinates + bytes;
+}
+
+/**
+ * \param[in] picture The report of the picture.
+ * \param[in] output The stream receiving the JSON document.
+ */
+void TikzReport::WriteJson(const Picture &picture, std::ostream &output) {
+	output << "{\n\t\"filename\": ";
+	WriteJsonString(output, picture.filename);
+	output << ",\n\t\"unchanged\": " << (picture.unchanged ? "true" : "false")
+		<< ",\n\t\"bytes\": " << picture.bytes
+		<< ",\n\t\"hashSeconds\": " << picture.hashSeconds
+		<< ",\n\t\"seconds\": " << picture.seconds
+		<< ",\n\t\"texMemory\": " << picture.texMemory
+		<< ",\n\t\"axes\": [";
+	for (size_t axisId = 0; axisId < picture.axes.size(); axisId++) {
+		const Axis &axis = picture.axes[axisId];
+		output << (axisId ? ",\n" : "\n") << "\t\t{\n\t\t\t\"environment\": ";
+		WriteJsonString(output, axis.environment);
+		output << ",\n\t\t\t\"bytes\": " << axis.bytes
+			<< ",\n\t\t\t\"preprocessSeconds\": " << axis.preprocessSeconds
+			<< ",\n\t\t\t\"seconds\": " << axis.seconds
+			<< ",\n\t\t\t\"texMemory\": " << axis.texMemory
+			<< ",\n\t\t\t\"plots\": [";
+		for (size_t plotId = 0; plotId < axis.plots.size(); plotId++) {
+			const Plot &plot = axis.plots[plotId];
+			output << (plotId ? ",\n" : "\n") << "\t\t\t\t{\"name\": ";
+			WriteJsonString(output, plot.name);
+			output << ", \"type\": ";
+			WriteJsonString(output, plot.type);
+			output << ", \"strategy\": ";
+			WriteJsonString(output, plot.strategy);
+			output << ", \"items\": " << plot.items
+				<< ", \"coordinates\": " << plot.coordinates
+				<< ", \"suppressed\": " << plot.suppressed
+				<< ", \"bytes\": " << plot.bytes
+				<< ", \"tableBytes\": " << plot.tableBytes
+				<< ", \"seconds\": " << plot.seconds
+				<< ", \"texMemory\": " << plot.texMemory << "}";
+		}
+		output << "\n\t\t\t]\n\t\t}";
+	}
+	output << "\n\t]\n}\n";
+}
+
+int TikzReport::CountingBuffer::overflow(int c) {
+	if (c == traits_type::eof()) return traits_type::not_eof(c);
+	count_++;
+	return buf_->sputc(traits_type::to_char_type(c));
+}
+
+std::streamsize TikzReport::CountingBuffer::xsputn(const char *data,
+                                                   std::streamsize length)
+{
+	count_ += length;
+	return buf_->sputn(data, length);
+}
@@ -0,0 +1,73 @@
+#include "TikzWriter.hpp"
+
+#include <cstring>
+
+#include "TikzNumber.hpp"
+
+TikzWriter::TikzWriter(std::streambuf *buf, const int &precision)
+	: buf_(buf), buffer_(kBufferSize), length_(0), precision_(precision),
+	  bytes_(0), coordinates_(0)
+{
+
+}
+
+TikzWriter::~TikzWriter() {
+	Flush();
+}
+
+void TikzWriter::Flush() {
+	if (length_) buf_->sputn(buffer_.data(), length_);
+	bytes_ += length_;
+	length_ = 0;
+}
+
+/** Append characters to the pending output. Blocks larger than the internal
+ * buffer are passed directly to the streambuf.
+ *
+ * \param[in] data The characters to be written.
+ * \param[in] length The number of characters.
+ */
+void TikzWriter::Write(const char *data, const size_t &length) {
+	if (length_ + length > kBufferSize) {
+		Flush();
+		if (length > kBufferSize) {
+			buf_->sputn(data, length);
+			bytes_ += length;
+			return;
+		}
+	}
+	std::memcpy(buffer_.data() + length_, data, length);
+	length_ += length;
+}
+
+TikzWriter& TikzWriter::operator<<(const char *str) {
+	Write(str, std::strlen(str));
+	return *this;
+}
+
+TikzWriter& TikzWriter::operator<<(const std::string &str) {
+	Write(str.data(), str.size());
+	return *this;
+}
+
+TikzWriter& TikzWriter::operator<<(const char &c) {
+	if (length_ == kBufferSize) Flush();
+	buffer_[length_++] = c;
+	return *this;
+}
+
+/** Integers are always written with all of their digits.
+ */
+TikzWriter& TikzWriter::operator<<(const int &value) {
+	if (length_ + TikzNumber::kMaxLength > kBufferSize) Flush();
+	length_ += TikzNumber::Format(value, buffer_.data() + length_);
+	return *this;
+}
+
+/** Format the value directly into the pending output.
+ */
+TikzWriter& TikzWriter::operator<<(const double &value) {
+	if (length_ + TikzNumber::kMaxLength > kBufferSize) Flush();
+	length_ += TikzNumber::Format(value, buffer_.data() + length_, precision_);
+	return *this;
+}
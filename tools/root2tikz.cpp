@@ -0,0 +1,461 @@
+/**
+ * @author Karl Smith
+ * @date Oct 16, 2026
+ *
+ * Command line converter writing every histogram and graph in a ROOT file as
+ * a TikZ figure. The directory tree of the file is mirrored in the output
+ * directory, e.g. the histogram "det/energy" is written to
+ * "<output>/det/energy.tex". The objects are read and written concurrently,
+ * each worker reading through its own handle of the file.
+ *
+ * Usage: root2tikz [options] <ROOT file>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TClass.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TGraph.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include "PgfPlotsAxis.hpp"
+#include "PgfPlotsPlot.hpp"
+#include "TikzParallel.hpp"
+#include "TikzPicture.hpp"
+#include "TikzReport.hpp"
+
+namespace {
+	/// The command line settings.
+	struct Settings {
+		std::string input;
+		std::string output;
+		/// Only the objects whose path matches are converted.
+		std::unique_ptr< std::regex > match;
+		/// The ROOT draw style of each class in the order given.
+		std::vector< std::pair< std::string, std::string > > styles;
+		unsigned int threads;
+		/// The coordinate budget of each figure, zero if unlimited.
+		size_t budget;
+		bool incremental;
+		/// The file the JSON summary is written to, empty if not written.
+		std::string summary;
+	};
+
+	/// An object in the file and the outcome of its conversion.
+	struct Item {
+		/// The path of the object within the file.
+		std::string path;
+		std::string type;
+		std::string filename;
+		bool unchanged;
+		size_t bytes;
+		size_t coordinates;
+		size_t texMemory;
+		double seconds;
+		/// The error message, empty if the figure was written.
+		std::string error;
+	};
+
+	/**Hands out open handles of a ROOT file. A TFile must not be read from
+	 * two threads at once, thus each worker holds a handle while reading an
+	 * object and returns it afterwards. At most one handle per worker is
+	 * opened.
+	 */
+	class FilePool {
+		public:
+			FilePool(const std::string &filename) : filename_(filename) {}
+
+			/// Take a handle, opening the file if none is free.
+			TFile *Acquire() {
+				{
+					std::lock_guard< std::mutex > lock(lock_);
+					if (!free_.empty()) {
+						TFile *file = free_.back();
+						free_.pop_back();
+						return file;
+					}
+				}
+				std::unique_ptr< TFile > file(TFile::Open(filename_.c_str(), "READ"));
+				if (!file || file->IsZombie()) {
+					throw std::runtime_error("ERROR: Unable to open '" + filename_ + "'!");
+				}
+				std::lock_guard< std::mutex > lock(lock_);
+				files_.emplace_back(std::move(file));
+				return files_.back().get();
+			}
+
+			/// Return a handle taken with Acquire.
+			void Release(TFile *file) {
+				std::lock_guard< std::mutex > lock(lock_);
+				free_.push_back(file);
+			}
+
+		private:
+			std::string filename_;
+			std::mutex lock_;
+			/// All opened handles.
+			std::vector< std::unique_ptr< TFile > > files_;
+			/// The handles not held by a worker.
+			std::vector< TFile* > free_;
+	};
+
+	void PrintUsage(const char *program) {
+		std::cerr << "Usage: " << program << " [options] <ROOT file>\n"
+			"Options:\n"
+			"  -o <directory>      Output directory, default is the current directory.\n"
+			"  -m <regex>          Only convert objects whose path matches the expression.\n"
+			"  -s <class>=<style>  ROOT draw style of a class and classes inheriting from it,\n"
+			"                      e.g. -s TH2=COLZ. May be given multiple times.\n"
+			"  -j <threads>        Number of threads, default uses all hardware threads.\n"
+			"  -b <coordinates>    Limit the coordinates written for each figure.\n"
+			"  -i                  Only rewrite figures whose content changed.\n"
+			"  -r <file>           Write a JSON summary of the conversion.\n";
+	}
+
+	/** Parse a non-negative integer argument.
+	 *
+	 * \param[in] value The argument.
+	 * \param[out] number The parsed number.
+	 * \return False if the argument is not a non-negative integer.
+	 */
+	bool ParseNumber(const std::string &value, unsigned long long &number) {
+		if (value.empty() || value[0] < '0' || value[0] > '9') return false;
+		char *end = nullptr;
+		errno = 0;
+		number = std::strtoull(value.c_str(), &end, 10);
+		return errno == 0 && *end == '\0';
+	}
+
+	/** Parse the command line arguments.
+	 *
+	 * \param[in] argc The number of arguments.
+	 * \param[in] argv The arguments.
+	 * \param[out] settings The settings parsed from the arguments.
+	 * \return False if the arguments are invalid.
+	 */
+	bool ParseArguments(int argc, char *argv[], Settings &settings) {
+		settings.output = ".";
+		settings.threads = 0;
+		settings.budget = 0;
+		settings.incremental = false;
+
+		for (int arg = 1; arg < argc; arg++) {
+			const std::string option = argv[arg];
+			if (option == "-i") {
+				settings.incremental = true;
+				continue;
+			}
+			if (option.size() != 2 || option[0] != '-') {
+				if (settings.input != "") {
+					std::cerr << "ERROR: More than one input file given!\n";
+					return false;
+				}
+				settings.input = option;
+				continue;
+			}
+			if (arg + 1 >= argc) {
+				std::cerr << "ERROR: Option " << option << " requires an argument!\n";
+				return false;
+			}
+			const std::string value = argv[++arg];
+			if (option == "-o") settings.output = value;
+			else if (option == "-m") {
+				try {
+					settings.match.reset(new std::regex(value));
+				}
+				catch (std::regex_error &error) {
+					std::cerr << "ERROR: Invalid expression '" << value << "': " << error.what() << "\n";
+					return false;
+				}
+			}
+			else if (option == "-s") {
+				const size_t equal = value.find('=');
+				if (equal == std::string::npos || equal == 0) {
+					std::cerr << "ERROR: Style '" << value << "' is not of the form <class>=<style>!\n";
+					return false;
+				}
+				settings.styles.emplace_back(value.substr(0, equal), value.substr(equal + 1));
+			}
+			else if (option == "-j" || option == "-b") {
+				unsigned long long number = 0;
+				if (!ParseNumber(value, number)
+					|| (option == "-j" && number > std::numeric_limits< unsigned int >::max()))
+				{
+					std::cerr << "ERROR: Option " << option << " requires a non-negative integer, not '"
+						<< value << "'!\n";
+					return false;
+				}
+				if (option == "-j") settings.threads = number;
+				else settings.budget = number;
+			}
+			else if (option == "-r") settings.summary = value;
+			else {
+				std::cerr << "ERROR: Unknown option " << option << "!\n";
+				return false;
+			}
+		}
+		return settings.input != "";
+	}
+
+	/** Collect the histograms and graphs in a directory and its
+	 * subdirectories. Only the highest cycle of each key is used. Three
+	 * dimensional histograms and graphs cannot be drawn and are skipped.
+	 *
+	 * \param[in] directory The directory to be searched.
+	 * \param[in] path The path of the directory within the file.
+	 * \param[in] settings The settings selecting the objects.
+	 * \param[out] items The objects found.
+	 */
+	void Collect(TDirectory *directory, const std::string &path,
+	             const Settings &settings, std::vector< Item > &items)
+	{
+		std::set< std::string > names;
+		TIter next(directory->GetListOfKeys());
+		while (TKey *key = static_cast<TKey*>(next())) {
+			//The keys are listed with the highest cycle first.
+			if (!names.insert(key->GetName()).second) continue;
+			TClass *type = TClass::GetClass(key->GetClassName());
+			if (!type) continue;
+
+			const std::string keyPath = path == "" ? key->GetName() : path + "/" + key->GetName();
+			if (type->InheritsFrom("TDirectory")) {
+				TDirectory *subDirectory = directory->GetDirectory(key->GetName());
+				if (subDirectory) Collect(subDirectory, keyPath, settings, items);
+				continue;
+			}
+			if (!type->InheritsFrom("TH1") && !type->InheritsFrom("TGraph")) continue;
+			if (type->InheritsFrom("TH3") || type->InheritsFrom("TGraph2D")) continue;
+			if (settings.match && !std::regex_search(keyPath, *settings.match)) continue;
+
+			Item item = Item();
+			item.path = keyPath;
+			item.type = key->GetClassName();
+			items.push_back(item);
+		}
+	}
+
+	/** Find the draw style of a class. A style given for the class itself
+	 * takes precedence over one given for a base class.
+	 *
+	 * \param[in] type The class of the object.
+	 * \param[in] settings The settings containing the styles.
+	 * \return The ROOT draw style, empty for the default style.
+	 */
+	std::string GetStyle(TClass *type, const Settings &settings) {
+		for (auto &style : settings.styles) {
+			if (style.first == type->GetName()) return style.second;
+		}
+		for (auto &style : settings.styles) {
+			if (type->InheritsFrom(style.first.c_str())) return style.second;
+		}
+		return "";
+	}
+
+	/** Build a file name from an object path, replacing characters that
+	 * cause trouble in file names or TeX \input commands.
+	 *
+	 * \param[in] path The path of the object within the file.
+	 * \return The file name relative to the output directory.
+	 */
+	std::string GetFilename(const std::string &path) {
+		std::string filename = path;
+		for (char &c : filename) {
+			const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+				|| (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || c == '/';
+			if (!valid) c = '_';
+		}
+		return filename + ".tex";
+	}
+
+	/** Read an object and write it as a figure.
+	 *
+	 * \param[in] file The handle used to read the object.
+	 * \param[in] settings The conversion settings.
+	 * \param[in,out] item The object to be converted, receiving the outcome.
+	 */
+	void Convert(TFile *file, const Settings &settings, Item &item) {
+		std::unique_ptr< TObject > object(file->Get(item.path.c_str()));
+		if (!object) {
+			throw std::runtime_error("ERROR: Unable to read '" + item.path + "'!");
+		}
+		const std::string style = GetStyle(object->IsA(), settings);
+
+		std::unique_ptr< PgfPlotsPlot > plot;
+		if (TH1 *hist = dynamic_cast<TH1*>(object.get())) {
+			plot.reset(new PgfPlotsPlot(hist, style));
+		}
+		else if (TGraph *graph = dynamic_cast<TGraph*>(object.get())) {
+			plot.reset(new PgfPlotsPlot(graph, style));
+		}
+		else {
+			throw std::runtime_error("ERROR: '" + item.path + "' is not a histogram or graph!");
+		}
+
+		PgfPlotsAxis axis;
+		axis.AddPlot(plot.get());
+		TikzPicture picture;
+		picture.SetBudget(settings.budget);
+		picture.SetIncremental(settings.incremental);
+		picture.Add(&axis);
+		picture.Write(item.filename);
+
+		const TikzReport::Picture &report = picture.GetReport();
+		item.unchanged = report.unchanged;
+		item.bytes = report.bytes;
+		item.texMemory = report.texMemory;
+		for (auto &axisReport : report.axes) {
+			for (auto &plotReport : axisReport.plots) {
+				item.coordinates += plotReport.coordinates;
+			}
+		}
+	}
+
+	/** Write the summary of the conversion as JSON.
+	 *
+	 * \param[in] settings The conversion settings.
+	 * \param[in] items The converted objects.
+	 * \param[in] threads The number of threads used.
+	 * \param[in] wallTime The elapsed time of the conversion in seconds.
+	 */
+	void WriteSummary(const Settings &settings, const std::vector< Item > &items,
+	                  const unsigned int &threads, const double &wallTime)
+	{
+		std::ofstream output(settings.summary);
+		if (!output) {
+			std::cerr << "WARNING: Unable to write the summary '" << settings.summary << "'.\n";
+			return;
+		}
+
+		size_t failed = 0;
+		for (auto &item : items) if (item.error != "") failed++;
+
+		output << "{\n\t\"input\": ";
+		TikzReport::WriteJsonString(output, settings.input);
+		output << ",\n\t\"output\": ";
+		TikzReport::WriteJsonString(output, settings.output);
+		output << ",\n\t\"threads\": " << threads
+			<< ",\n\t\"wallTime\": " << wallTime
+			<< ",\n\t\"objects\": " << items.size()
+			<< ",\n\t\"failed\": " << failed
+			<< ",\n\t\"figures\": [";
+		for (size_t index = 0; index < items.size(); index++) {
+			const Item &item = items[index];
+			output << (index ? ",\n" : "\n") << "\t\t{\"path\": ";
+			TikzReport::WriteJsonString(output, item.path);
+			output << ", \"type\": ";
+			TikzReport::WriteJsonString(output, item.type);
+			output << ", \"filename\": ";
+			TikzReport::WriteJsonString(output, item.filename);
+			output << ", \"unchanged\": " << (item.unchanged ? "true" : "false")
+				<< ", \"bytes\": " << item.bytes
+				<< ", \"coordinates\": " << item.coordinates
+				<< ", \"texMemory\": " << item.texMemory
+				<< ", \"seconds\": " << item.seconds
+				<< ", \"error\": ";
+			TikzReport::WriteJsonString(output, item.error);
+			output << "}";
+		}
+		output << "\n\t]\n}\n";
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Settings settings;
+	if (!ParseArguments(argc, argv, settings)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	const unsigned int threads = TikzParallel::GetThreads(settings.threads);
+	if (threads > 1) ROOT::EnableThreadSafety();
+	//The objects read are owned by the converter rather than the file.
+	TH1::AddDirectory(false);
+
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+
+	FilePool files(settings.input);
+	std::vector< Item > items;
+	TFile *file = nullptr;
+	try {
+		file = files.Acquire();
+	}
+	catch (std::exception &exception) {
+		std::cerr << exception.what() << "\n";
+		return 1;
+	}
+	Collect(file, "", settings, items);
+	files.Release(file);
+
+	//Create the output directories before the workers write into them.
+	//Paths mapped to the same file name are numbered in the order found.
+	std::set< std::string > filenames;
+	std::set< std::string > directories;
+	for (auto &item : items) {
+		const std::string filename = GetFilename(item.path);
+		item.filename = settings.output + "/" + filename;
+		for (unsigned int number = 2; !filenames.insert(item.filename).second; number++) {
+			item.filename = settings.output + "/" + filename.substr(0, filename.size() - 4)
+				+ "-" + std::to_string(number) + ".tex";
+		}
+		if (item.filename != settings.output + "/" + filename) {
+			std::cerr << "WARNING: '" << item.path << "' is written to '" << item.filename
+				<< "' as its file name is already used.\n";
+		}
+		directories.insert(item.filename.substr(0, item.filename.find_last_of('/')));
+	}
+	for (auto &directory : directories) {
+		gSystem->mkdir(directory.c_str(), true);
+	}
+
+	TikzParallel::For(items.size(), threads, [&](const size_t &index) {
+		Item &item = items[index];
+		const Clock::time_point itemStart = Clock::now();
+		TFile *handle = nullptr;
+		try {
+			handle = files.Acquire();
+			Convert(handle, settings, item);
+		}
+		catch (std::exception &exception) {
+			item.error = exception.what();
+		}
+		catch (...) {
+			item.error = "ERROR: Unknown exception!";
+		}
+		if (handle) files.Release(handle);
+		item.seconds = std::chrono::duration< double >(Clock::now() - itemStart).count();
+	});
+	const double wallTime = std::chrono::duration< double >(Clock::now() - start).count();
+
+	size_t failed = 0;
+	for (auto &item : items) {
+		if (item.error == "") continue;
+		std::cerr << item.path << ": " << item.error << "\n";
+		failed++;
+	}
+	std::cout << "Converted " << items.size() - failed << " of " << items.size()
+		<< " objects in " << wallTime << " s on " << threads << " threads.\n";
+
+	if (settings.summary != "") WriteSummary(settings, items, threads, wallTime);
+
+	return failed ? 1 : 0;
+}